@@ -0,0 +1,123 @@
+#include "plumed/tools/Tools.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// Tools::convert parses simple numbers with a fast path and falls back to
+// streams (and to lepton for reals) otherwise. Here the results are printed
+// for a list of corner cases and checked against strtod/strtof for many
+// randomly generated decimal numbers.
+
+std::string format(double d) {
+  if(std::isnan(d)) return "nan";
+  if(std::isinf(d)) return (d>0?"inf":"-inf");
+  char buffer[64];
+  std::sprintf(buffer,"%.17g",d);
+  return buffer;
+}
+
+template<class T>
+void print(std::ostream & ofs,const std::string & type,const std::string & str) {
+  T t=0;
+  bool ok=Tools::convert(str,t);
+  ofs<<type<<" \""<<str<<"\" ";
+  if(ok) ofs<<format(t);
+  else ofs<<"not converted";
+  ofs<<"\n";
+}
+
+// deterministic pseudo random numbers
+unsigned long long seed=12345;
+unsigned next(unsigned n) {
+  seed=seed*6364136223846793005ULL+1442695040888963407ULL;
+  return (seed>>33)%n;
+}
+
+std::string randomNumber(unsigned maxdigits,int maxexp) {
+  std::string str;
+  unsigned s=next(3);
+  if(s==1) str+="-";
+  if(s==2) str+="+";
+  unsigned ndigits=1+next(maxdigits);
+  unsigned point=next(ndigits+2);
+  for(unsigned i=0; i<ndigits; i++) {
+    if(i==point) str+=".";
+    str+=static_cast<char>('0'+next(10));
+  }
+  if(next(2)) {
+    str+=(next(2)?"e":"E");
+    unsigned es=next(3);
+    if(es==1) str+="-";
+    if(es==2) str+="+";
+    str+=std::to_string(next(maxexp+1));
+  }
+  return str;
+}
+
+int main() {
+  std::ofstream ofs("output");
+
+  const std::vector<std::string> reals= {
+    "0","-0","+0","1","+1","-1","1.5","+1.5","-1.25e-3","1E5","1e+05","1e-05",
+    "0.1","0.2","0.3",".5","+.5e-2","5.","00012.500",
+    "1e22","1e23","1e-22","1e-23","123456789e15",
+    "9007199254740992","9007199254740993","18014398509481985",
+    "1234567890123456789","12345678901234567890","0.000000000000000000001234",
+    "3.14159265358979323846264338327950288",
+    "2.2250738585072014e-308","1.7976931348623157e308","1e308","1e400","-1e400",
+    "inf","-inf","nan","NAN",
+    "pi","-PI","2pi","0.5PI","1+1","2*3",
+    " 1","1 ","1.2.3",".","e5","1e","1e+","+","-","","0x10","1,5","1d5","--1"
+  };
+  for(const auto & s : reals) print<double>(ofs,"double",s);
+  for(const auto & s : reals) print<float>(ofs,"float",s);
+
+  const std::vector<std::string> integers= {
+    "0","-0","+0","12","+12","-12","007","2147483647","2147483648","-2147483648","-2147483649",
+    "4294967295","4294967296","9223372036854775807","-9223372036854775808","9223372036854775808",
+    "123456789012345678901","1.0","1e3"," 1","1 ","12a","+","-","","0x10"
+  };
+  for(const auto & s : integers) print<int>(ofs,"int",s);
+  for(const auto & s : integers) print<unsigned>(ofs,"unsigned",s);
+  for(const auto & s : integers) print<long int>(ofs,"long",s);
+
+// compare with strtod and strtof, which are correctly rounded
+  const unsigned ntests=200000;
+  unsigned nconverted=0,ndiff=0;
+  for(unsigned i=0; i<ntests; i++) {
+    std::string str=randomNumber(i%2?17:22,i%3?22:300);
+    char* end;
+    double ref=std::strtod(str.c_str(),&end);
+    if(*end || std::isinf(ref) || (ref!=0.0 && std::fabs(ref)<2.3e-308)) continue;
+    nconverted++;
+    double d;
+    if(!Tools::convert(str,d) || std::memcmp(&d,&ref,sizeof(double))!=0) {
+      ndiff++;
+      ofs<<"double mismatch \""<<str<<"\" "<<format(d)<<" "<<format(ref)<<"\n";
+    }
+  }
+  ofs<<"double: "<<(nconverted>ntests/2 ? "enough" : "too few")<<" numbers tested, "<<ndiff<<" different from strtod\n";
+
+  nconverted=0; ndiff=0;
+  for(unsigned i=0; i<ntests; i++) {
+    std::string str=randomNumber(i%2?8:12,i%3?10:30);
+    char* end;
+    float ref=std::strtof(str.c_str(),&end);
+    if(*end || std::isinf(ref) || (ref!=0.0f && std::fabs(ref)<1.2e-38f)) continue;
+    nconverted++;
+    float f;
+    if(!Tools::convert(str,f) || std::memcmp(&f,&ref,sizeof(float))!=0) {
+      ndiff++;
+      ofs<<"float mismatch \""<<str<<"\" "<<format(f)<<" "<<format(ref)<<"\n";
+    }
+  }
+  ofs<<"float: "<<(nconverted>ntests/2 ? "enough" : "too few")<<" numbers tested, "<<ndiff<<" different from strtof\n";
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The same steps are done passing the data with separate commands and with
+// setStepData through plumed_cmd (main.cpp) and with command handles of a
+// PlumedMain object (handles.cpp). Results should be identical.
+
+const int natoms=10;
+const long int nsteps=5;
+
+const char* const input[]= {
+  "d: DISTANCE ATOMS=1,2",
+  "e: DISTANCE ATOMS=3,10",
+  "RESTRAINT ARG=d,e AT=0,0 KAPPA=1,2"
+};
+
+inline void setPositions(long int step,std::vector<double> & positions) {
+  for(unsigned i=0; i<positions.size(); i++) positions[i]=0.1*i+0.37*step*(i%3);
+}
+
+std::vector<double> runWithHandles(const std::string & logfile);
+
+void testHandles(std::ostream & ofs);
@@ -0,0 +1,63 @@
+#include "plumed/core/PlumedMain.h"
+#include "plumed/tools/Exception.h"
+#include "common.h"
+#include <algorithm>
+
+using namespace PLMD;
+
+std::vector<double> runWithHandles(const std::string & logfile) {
+  PlumedMain p;
+  int n=natoms;
+  p.cmd("setNatoms",&n);
+  p.cmd("setLogFile",const_cast<char*>(logfile.c_str()));
+  p.cmd("init");
+  for(const char* line : input) p.cmd("readInputLine",const_cast<char*>(line));
+
+  PlumedMain::CommandHandle setStepData=p.getCommandHandle("setStepData");
+  PlumedMain::CommandHandle calc=p.getCommandHandle("calc");
+
+  std::vector<double> results;
+  std::vector<double> positions(3*natoms),masses(natoms,1.0),forces(3*natoms);
+  std::vector<double> box(9,0.0),virial(9);
+  box[0]=box[4]=box[8]=5.0;
+  for(long int step=0; step<nsteps; step++) {
+    setPositions(step,positions);
+    std::fill(forces.begin(),forces.end(),0.0);
+    std::fill(virial.begin(),virial.end(),0.0);
+    void* data[8]= {&step,&box[0],&positions[0],&masses[0],NULL,&forces[0],&virial[0],NULL};
+    p.cmd(setStepData,data);
+    p.cmd(calc);
+    double bias;
+    p.cmd("getBias",&bias);
+    results.push_back(bias);
+    results.insert(results.end(),forces.begin(),forces.end());
+    results.insert(results.end(),virial.begin(),virial.end());
+  }
+  return results;
+}
+
+static void testHandle(std::ostream & ofs,PlumedMain & p,const std::string & cmd) {
+  ofs<<"getCommandHandle "<<cmd<<std::endl;
+  try {
+    p.getCommandHandle(cmd);
+    ofs<<"+++ !!!! uncatched !!!!"<<std::endl;
+  } catch(Exception&e) {
+    ofs<<"+++ catched"<<std::endl;
+  }
+}
+
+void testHandles(std::ostream & ofs) {
+// only commands executed at every step can be resolved
+  PlumedMain p;
+  testHandle(ofs,p,"init");
+  testHandle(ofs,p,"readInputLine");
+  testHandle(ofs,p,"setStep now");
+  testHandle(ofs,p,"notACommand");
+  ofs<<"cmd with an empty handle"<<std::endl;
+  try {
+    p.cmd(PlumedMain::CommandHandle());
+    ofs<<"+++ !!!! uncatched !!!!"<<std::endl;
+  } catch(Exception&e) {
+    ofs<<"+++ catched"<<std::endl;
+  }
+}
@@ -0,0 +1,59 @@
+#include "plumed/wrapper/Plumed.h"
+#include "common.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+std::vector<double> run(bool stepdata,const std::string & logfile) {
+  plumed p=plumed_create();
+  int n=natoms;
+  plumed_cmd(p,"setNatoms",&n);
+  plumed_cmd(p,"setLogFile",logfile.c_str());
+  plumed_cmd(p,"init",NULL);
+  for(const char* line : input) plumed_cmd(p,"readInputLine",line);
+
+  std::vector<double> results;
+  std::vector<double> positions(3*natoms),masses(natoms,1.0),forces(3*natoms);
+  std::vector<double> box(9,0.0),virial(9);
+  box[0]=box[4]=box[8]=5.0;
+  for(long int step=0; step<nsteps; step++) {
+    setPositions(step,positions);
+    std::fill(forces.begin(),forces.end(),0.0);
+    std::fill(virial.begin(),virial.end(),0.0);
+    if(stepdata) {
+      void* data[8]= {&step,&box[0],&positions[0],&masses[0],NULL,&forces[0],&virial[0],NULL};
+      plumed_cmd(p,"setStepData",data);
+    } else {
+      plumed_cmd(p,"setStepLong",&step);
+      plumed_cmd(p,"setBox",&box[0]);
+      plumed_cmd(p,"setPositions",&positions[0]);
+      plumed_cmd(p,"setMasses",&masses[0]);
+      plumed_cmd(p,"setForces",&forces[0]);
+      plumed_cmd(p,"setVirial",&virial[0]);
+    }
+    plumed_cmd(p,"calc",NULL);
+    double bias;
+    plumed_cmd(p,"getBias",&bias);
+    results.push_back(bias);
+    results.insert(results.end(),forces.begin(),forces.end());
+    results.insert(results.end(),virial.begin(),virial.end());
+  }
+  plumed_finalize(p);
+  return results;
+}
+
+int main() {
+  std::ofstream ofs("output");
+
+  std::vector<double> ref=run(false,"separate.log");
+  ofs<<std::fixed<<std::setprecision(6);
+  for(unsigned i=0; i<ref.size(); i++) ofs<<ref[i]<<"\n";
+
+  std::vector<double> sd=run(true,"stepdata.log");
+  ofs<<"setStepData "<<(sd==ref ? "identical" : "different")<<std::endl;
+  std::vector<double> hd=runWithHandles("handles.log");
+  ofs<<"handles "<<(hd==ref ? "identical" : "different")<<std::endl;
+
+  testHandles(ofs);
+  return 0;
+}
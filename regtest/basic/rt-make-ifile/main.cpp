@@ -0,0 +1,76 @@
+#include "plumed/tools/IFile.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// The same file is read by field name, by field index and with scanRows.
+// The file has comments, a line with braces, constant fields and a
+// change in the order of the fields.
+
+const std::vector<std::string> names= {"time","x","y"};
+
+void readConstants(IFile & ifile,std::vector<std::string> & constants) {
+  constants.clear();
+  for(const std::string c : {"min_x","max_x","c"}) {
+    if(ifile.FieldExist(c)) {
+      std::string value;
+      ifile.scanField(c,value);
+      constants.push_back(c+"="+value);
+    }
+  }
+}
+
+int main() {
+  std::ofstream ofs("output");
+
+  std::vector<double> byname;
+  {
+    IFile ifile; ifile.open("input");
+    double t;
+    while(ifile.scanField("time",t)) {
+      double x; int y;
+      ifile.scanField("x",x);
+      ifile.scanField("y",y);
+      std::vector<std::string> constants;
+      readConstants(ifile,constants);
+      ifile.scanField();
+      byname.push_back(t); byname.push_back(x); byname.push_back(y);
+      ofs<<t<<" "<<x<<" "<<y;
+      for(const auto & c : constants) ofs<<" "<<c;
+      ofs<<"\n";
+    }
+  }
+
+  std::vector<double> byindex;
+  {
+    IFile ifile; ifile.open("input");
+    std::vector<unsigned> index(names.size());
+    unsigned version=0;
+    while(true) {
+      index[0]=ifile.getFieldIndex(names[0]);
+      if(!ifile) break;
+      if(byindex.empty() || version!=ifile.getFieldsVersion()) {
+        for(unsigned i=0; i<names.size(); i++) index[i]=ifile.getFieldIndex(names[i]);
+        version=ifile.getFieldsVersion();
+      }
+      for(unsigned i=0; i<names.size(); i++) {
+        double v; ifile.scanField(index[i],v); byindex.push_back(v);
+      }
+      std::vector<std::string> constants;
+      readConstants(ifile,constants);
+      ifile.scanField();
+    }
+  }
+  ofs<<"by index "<<(byindex==byname ? "identical" : "different")<<"\n";
+
+  std::vector<double> rows;
+  {
+    IFile ifile; ifile.open("input");
+    ifile.scanRows(names,rows);
+  }
+  ofs<<"scanRows "<<(rows==byname ? "identical" : "different")<<"\n";
+
+  return 0;
+}
@@ -0,0 +1,6 @@
+export PATH="/root/repo/src/lib/:$PATH"
+export LIBRARY_PATH="/root/repo/src/lib/:$LIBRARY_PATH"
+export LD_LIBRARY_PATH="/root/repo/src/lib/:$LD_LIBRARY_PATH"
+export PLUMED_KERNEL="/root/repo/src/lib/libplumedKernel.so"
+export PLUMED_VIMPATH="/root/repo/vim"
+export PYTHONPATH="/root/repo/python:$PYTHONPATH"
@@ -42,6 +42,9 @@ void Analysis::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","RUN","0","the frequency with which to run the analysis algorithm. The default value of zero assumes you want to analyse the whole trajectory");
   keys.add("optional","FMT","the format that should be used in analysis output files");
   keys.addFlag("WRITE_CHECKPOINT",false,"write out a checkpoint so that the analysis can be restarted in a later run");
+  keys.add("optional","MEMORY_BUDGET","the maximum memory in megabytes that is used to store the frames when arguments are analysed with the EUCLIDEAN metric. "
+           "If more frames are collected they are moved to a scratch file that is mapped in memory");
+  keys.add("compulsory","SCRATCH_DIR",".","the directory in which the scratch file for the frames is created when MEMORY_BUDGET is exceeded");
   keys.add("hidden","REUSE_DATA_FROM","eventually this will allow you to analyse the same set of data multiple times");
   keys.add("hidden","IGNORE_REWEIGHTING","this allows you to ignore any reweighting factors");
   keys.use("RESTART"); keys.use("UPDATE_FROM"); keys.use("UPDATE_UNTIL"); keys.remove("TOL");
@@ -55,6 +58,7 @@ Analysis::Analysis(const ActionOptions&ao):
   reusing_data(false),
   ignore_reweight(false),
   idata(0),
+  columnar(false),
 //firstAnalysisDone(false),
 //old_norm(0.0),
   ofmt("%f"),
@@ -79,6 +83,8 @@ Analysis::Analysis(const ActionOptions&ao):
   ReferenceArguments* hasargs=dynamic_cast<ReferenceArguments*>( checkref.get() );
   if( !hasargs && getNumberOfArguments()!=0 ) error("use of arguments with metric type " + metricname + " is invalid");
   if( hasatoms && hasargs ) error("currently dependencies break if you have both arguments and atoms");
+  // Arguments compared using the EUCLIDEAN metric are stored one frame after the other in a single matrix
+  columnar=( metricname=="EUCLIDEAN" && !hasatoms );
 
   std::string prev_analysis; parse("REUSE_DATA_FROM",prev_analysis);
   if( prev_analysis.length()>0 ) {
@@ -89,16 +95,30 @@ Analysis::Analysis(const ActionOptions&ao):
     if( ignore_reweight ) log.printf("  reusing data stored by %s but ignoring all reweighting\n",prev_analysis.c_str() );
     else log.printf("  reusing data stored by %s\n",prev_analysis.c_str() );
   } else {
+    if( columnar ) frames.setNumberOfFeatures( getNumberOfArguments() );
+    double budget=0; parse("MEMORY_BUDGET",budget);
+    std::string scratchdir; parse("SCRATCH_DIR",scratchdir);
+    if( budget>0 ) {
+      if( !columnar ) error("MEMORY_BUDGET can only be used when arguments are analysed with the EUCLIDEAN metric");
+      if( !FrameStore::canSpill() ) error("MEMORY_BUDGET cannot be used as PLUMED was compiled without mmap");
+      frames.setMemoryBudget( static_cast<size_t>( budget*1024*1024 ), scratchdir );
+      log.printf("  frames exceeding %f MB are moved to a scratch file in directory %s\n",budget,scratchdir.c_str() );
+    }
     parse("RUN",freq);
     if( freq==0 ) {
       log.printf("  analyzing all data in trajectory\n");
     } else {
       if( freq%getStride()!=0 ) error("frequncy of running is not a multiple of the stride");
       log.printf("  running analysis every %u steps\n",freq);
-      ndata=freq/getStride(); data.resize( ndata ); logweights.resize( ndata );
-      for(unsigned i=0; i<ndata; ++i) {
-        data[i].reset(metricRegister().create<ReferenceConfiguration>( metricname ));
-        data[i]->setNamesAndAtomNumbers( getAbsoluteIndexes(), argument_names );
+      ndata=freq/getStride(); logweights.resize( ndata );
+      if( columnar ) {
+        frames.resize( ndata );
+      } else {
+        data.resize( ndata );
+        for(unsigned i=0; i<ndata; ++i) {
+          data[i].reset(metricRegister().create<ReferenceConfiguration>( metricname ));
+          data[i]->setNamesAndAtomNumbers( getAbsoluteIndexes(), argument_names );
+        }
       }
     }
     parseFlag("WRITE_CHECKPOINT",write_chq);
@@ -138,14 +158,18 @@ void Analysis::readDataFromFile( const std::string& filename ) {
       PDB mypdb;
       do_read=mypdb.readFromFilepointer(fp,plumed.getAtoms().usingNaturalUnits(),0.1/atoms.getUnits().getLength());
       if(do_read) {
-        data[idata]->set( mypdb );
-        data[idata]->parse("TIME",tstep);
+        ReferenceConfiguration* myref;
+        if( columnar ) myref=setupBuffer( iobuffer );
+        else myref=data[idata].get();
+        myref->set( mypdb );
+        myref->parse("TIME",tstep);
         if( !first && ((tstep-oldtstep) - getStride()*plumed.getAtoms().getTimeStep())>plumed.getAtoms().getTimeStep() ) {
           error("frequency of data storage in " + filename + " is not equal to frequency of data storage plumed.dat file");
         }
-        data[idata]->parse("LOG_WEIGHT",logweights[idata]);
-        //data[idata]->parse("OLD_NORM",old_norm);
-        data[idata]->checkRead();
+        myref->parse("LOG_WEIGHT",logweights[idata]);
+        //myref->parse("OLD_NORM",old_norm);
+        myref->checkRead();
+        if( columnar ) frames.setFrame( idata, myref->getReferenceArguments() );
         idata++; first=false; oldtstep=tstep;
       } else {
         break;
@@ -175,7 +199,12 @@ void Analysis::accumulate() {
   // Get the arguments ready to transfer to reference configuration
   for(unsigned i=0; i<getNumberOfArguments(); ++i) current_args[i]=getArgument(i);
 
-  if( freq>0) {
+  if( columnar ) {
+    // Store the arguments in the next row of the frame store
+    if( freq==0 ) { frames.resize( idata+1 ); logweights.push_back(lweight); }
+    else logweights[idata] = lweight;
+    frames.setFrame( idata, current_args );
+  } else if( freq>0) {
     // Get the arguments and store them in a vector of vectors
     data[idata]->setReferenceConfig( getPositions(), current_args, getMetric() );
     logweights[idata] = lweight;
@@ -190,7 +219,7 @@ void Analysis::accumulate() {
   // Write data to checkpoint file
   if( write_chq ) {
     rfile.rewind();
-    data[idata]->print( rfile, getTime(), logweights[idata], atoms.getUnits().getLength()/0.1, 1.0 ); //old_norm );
+    getStoredConfiguration( idata, iobuffer )->print( rfile, getTime(), logweights[idata], atoms.getUnits().getLength()/0.1, 1.0 ); //old_norm );
     rfile.flush();
   }
   // Increment data counter
@@ -210,8 +239,56 @@ std::vector<double> Analysis::getMetric() const {
   return empty;
 }
 
+ReferenceConfiguration* Analysis::setupBuffer( std::unique_ptr<ReferenceConfiguration>& buffer ) {
+  if( !buffer ) {
+    buffer.reset( metricRegister().create<ReferenceConfiguration>( metricname ) );
+    buffer->setNamesAndAtomNumbers( getAbsoluteIndexes(), argument_names );
+  }
+  return buffer.get();
+}
+
+ReferenceConfiguration* Analysis::getStoredConfiguration( const unsigned& idata, std::unique_ptr<ReferenceConfiguration>& buffer ) {
+  if( reusing_data ) return mydatastash->getStoredConfiguration( idata, buffer );
+  if( !columnar ) return data[idata].get();
+  ReferenceConfiguration* myref=setupBuffer( buffer );
+  const double* frame=frames.getFrame( idata );
+  std::vector<double> args( frame, frame+frames.getNumberOfFeatures() ); std::vector<Vector> nopos;
+  myref->setReferenceConfig( nopos, args, getMetric() );
+  myref->setWeight( frames.getWeight( idata ) );
+  return myref;
+}
+
+double Analysis::getDistanceBetweenFrames( const unsigned& iframe, const unsigned& jframe ) {
+  if( reusing_data ) return mydatastash->getDistanceBetweenFrames( iframe, jframe );
+  if( !columnar ) return distance( getPbc(), getArguments(), data[iframe].get(), data[jframe].get(), false );
+  // This is the EUCLIDEAN distance computed directly on the rows of the frame store
+  const double* iargs=frames.getFrame( iframe ); const double* jargs=frames.getFrame( jframe );
+  double d2=0;
+  for(unsigned k=0; k<frames.getNumberOfFeatures(); ++k) {
+    double dk=getPntrToArgument(k)->difference( iargs[k], jargs[k] ); d2+=dk*dk;
+  }
+  return sqrt(d2);
+}
+
+double Analysis::getDistanceFromFrame( const unsigned& iframe, ReferenceConfiguration* myref ) {
+  if( reusing_data ) return mydatastash->getDistanceFromFrame( iframe, myref );
+  if( !columnar ) return distance( getPbc(), getArguments(), data[iframe].get(), myref, false );
+  const double* iargs=frames.getFrame( iframe ); const std::vector<double>& refargs=myref->getReferenceArguments();
+  double d2=0;
+  for(unsigned k=0; k<frames.getNumberOfFeatures(); ++k) {
+    double dk=getPntrToArgument(k)->difference( iargs[k], refargs[k] ); d2+=dk*dk;
+  }
+  return sqrt(d2);
+}
+
+void Analysis::setFrameWeight( const unsigned& idata, const double& w ) {
+  if( columnar ) frames.setWeight( idata, w );
+  else data[idata]->setWeight( w );
+}
+
 double Analysis::getWeight( const unsigned& idata ) const {
   if( !reusing_data ) {
+    if( columnar ) return frames.getWeight( idata );
     plumed_dbg_assert( idata<data.size() );
     return data[idata]->getWeight();
   } else {
@@ -226,7 +303,7 @@ void Analysis::finalizeWeights( const bool& ignore_weights ) {
   double norm=0;  // Reset normalization constant
   if( ignore_weights ) {
     for(unsigned i=0; i<logweights.size(); ++i) {
-      data[i]->setWeight(1.0); norm+=1.0;
+      setFrameWeight( i, 1.0 ); norm+=1.0;
     }
   } else if( nomemory ) {
     // Find the maximum weight
@@ -240,7 +317,7 @@ void Analysis::finalizeWeights( const bool& ignore_weights ) {
     }
     // Calculate weights (no memory)
     for(unsigned i=0; i<logweights.size(); ++i) {
-      data[i]->setWeight( exp( logweights[i]-maxweight ) );
+      setFrameWeight( i, exp( logweights[i]-maxweight ) );
     }
     // Calculate normalized weights (with memory)
   } else {
@@ -263,6 +340,12 @@ void Analysis::getDataPoint( const unsigned& idata, std::vector<double>& point,
   plumed_dbg_assert( getNumberOfAtoms()==0 );
   if( !reusing_data ) {
     plumed_dbg_assert( idata<logweights.size() &&  point.size()==getNumberOfArguments() );
+    if( columnar ) {
+      const double* frame=frames.getFrame( idata );
+      for(unsigned i=0; i<point.size(); ++i) point[i]=frame[i];
+      weight=frames.getWeight( idata );
+      return;
+    }
     for(unsigned i=0; i<point.size(); ++i) point[i]=data[idata]->getReferenceArgument(i);
     weight=data[idata]->getWeight();
   } else {
@@ -23,6 +23,7 @@
 #define __PLUMED_analysis_Analysis_h
 
 #include "vesselbase/ActionWithAveraging.h"
+#include "FrameStore.h"
 
 #define PLUMED_ANALYSIS_INIT(ao) Action(ao),Analysis(ao)
 
@@ -59,6 +60,12 @@ private:
   unsigned idata;
 /// The weights of all the data points
   std::vector<double> logweights;
+/// Are the data stored in the frame store rather than as reference configurations
+  bool columnar;
+/// The values of the arguments in all the frames (used with the EUCLIDEAN metric on arguments)
+  FrameStore frames;
+/// Buffer used to read and write frames kept in the frame store
+  std::unique_ptr<ReferenceConfiguration> iobuffer;
 /// Have we analyzed the data for the first time
 //  bool firstAnalysisDone;
 /// The value of the old normalization constant
@@ -75,6 +82,10 @@ private:
   void readDataFromFile( const std::string& filename );
 /// Get the metric if we are using malonobius distance and flexible hill
   std::vector<double> getMetric() const ;
+/// Set the weight of the ith point
+  void setFrameWeight( const unsigned& idata, const double& w );
+/// Create (if needed) a reference configuration that can hold one of the points
+  ReferenceConfiguration* setupBuffer( std::unique_ptr<ReferenceConfiguration>& buffer );
 protected:
 /// List of argument names
   std::vector<std::string> argument_names;
@@ -82,7 +93,7 @@ protected:
 /// this method is used and the calculation is not restarted old analysis
 /// files are backed up.
   void parseOutputFile( const std::string& key, std::string& filename );
-/// The data we are going to analyze
+/// The data we are going to analyze (empty if the frame store is used)
   std::vector<std::unique_ptr<ReferenceConfiguration>> data;
 /// Get the name of the metric we are using to measure distances
   std::string getMetricName() const ;
@@ -92,6 +103,13 @@ protected:
   double getWeight( const unsigned& idata ) const ;
 /// Retrieve the ith point
   void getDataPoint( const unsigned& idata, std::vector<double>& point, double& weight ) const ;
+/// Return the ith point as a reference configuration.  If the data are kept in the frame store
+/// the point is copied in buffer, which is created if it is empty, and a pointer to buffer is returned
+  ReferenceConfiguration* getStoredConfiguration( const unsigned& idata, std::unique_ptr<ReferenceConfiguration>& buffer );
+/// Calculate the distance between the ith and the jth points
+  double getDistanceBetweenFrames( const unsigned& iframe, const unsigned& jframe );
+/// Calculate the distance between the ith point and a reference configuration
+  double getDistanceFromFrame( const unsigned& iframe, ReferenceConfiguration* myref );
 /// Returns true if argument i is periodic together with the domain
   bool getPeriodicityInformation(const unsigned& i, std::string& dmin, std::string& dmax);
 /// Are we analyzing each data block separately (if we are not this also returns the old normalization )
@@ -124,6 +142,7 @@ std::string Analysis::getMetricName() const {
 inline
 unsigned Analysis::getNumberOfDataPoints() const {
   if( !reusing_data ) {
+    if( columnar ) return frames.size();
     plumed_dbg_assert( data.size()==logweights.size() );
     return data.size();
   } else {
@@ -0,0 +1,140 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2012-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "FrameStore.h"
+#include "tools/Exception.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __PLUMED_HAS_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#endif
+
+namespace PLMD {
+namespace analysis {
+
+FrameStore::FrameStore():
+  nfeatures(0),
+  nframes(0),
+  capacity(0),
+  budget(0),
+  scratchdir("."),
+  base(NULL),
+  fd(-1),
+  mapped(0)
+{
+}
+
+FrameStore::~FrameStore() {
+  unmapScratchFile();
+#ifdef __PLUMED_HAS_MMAP
+  if(fd>=0) ::close(fd);
+#endif
+}
+
+bool FrameStore::canSpill() {
+#ifdef __PLUMED_HAS_MMAP
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameStore::setNumberOfFeatures( const unsigned& n ) {
+  unmapScratchFile();
+#ifdef __PLUMED_HAS_MMAP
+  if(fd>=0) ::close(fd);
+#endif
+  fd=-1; base=NULL;
+  std::vector<double>().swap(memory);
+  weights.clear();
+  nfeatures=n; nframes=0; capacity=0;
+}
+
+void FrameStore::setMemoryBudget( const size_t& bytes, const std::string& dir ) {
+  if( bytes>0 && !canSpill() ) plumed_merror("cannot set a memory budget for the stored frames as PLUMED was compiled without mmap");
+  budget=bytes; scratchdir=dir;
+}
+
+void FrameStore::resize( const unsigned& n ) {
+  reserve( n );
+  if( n>nframes ) std::fill( base+size_t(nframes)*nfeatures, base+size_t(n)*nfeatures, 0.0 );
+  nframes=n; weights.resize( n, 1.0 );
+}
+
+void FrameStore::setFrame( const unsigned& i, const std::vector<double>& values ) {
+  plumed_dbg_assert( i<nframes && values.size()==nfeatures );
+  std::copy( values.begin(), values.end(), base+size_t(i)*nfeatures );
+}
+
+void FrameStore::reserve( size_t n ) {
+  if( n<=capacity ) return;
+  // Grow geometrically so that adding frames one at a time is cheap
+  n=std::max( n, 2*capacity );
+  // Frames without features take no space, and mapping zero bytes would fail
+  if( nfeatures>0 && ( isSpilled() || ( budget>0 && n*nfeatures*sizeof(double)>budget ) ) ) {
+    mapScratchFile( n );
+  } else {
+    memory.resize( n*nfeatures ); base=memory.data();
+  }
+  capacity=n;
+}
+
+void FrameStore::mapScratchFile( size_t n ) {
+#ifdef __PLUMED_HAS_MMAP
+  size_t bytes=n*nfeatures*sizeof(double);
+  plumed_assert( bytes>0 );
+  if( fd<0 ) {
+    std::string name=scratchdir + "/plumed-frames-XXXXXX";
+    std::vector<char> buffer( name.begin(), name.end() ); buffer.push_back('\0');
+    fd=mkstemp( buffer.data() );
+    if( fd<0 ) plumed_merror("cannot create scratch file " + name + " for the stored frames: " + std::strerror(errno) );
+    // The file is only accessed through the descriptor and vanishes when it is closed
+    unlink( buffer.data() );
+  }
+  // With a shared mapping the data already in the file survive the remapping
+  unmapScratchFile();
+  if( ftruncate( fd, bytes )!=0 ) plumed_merror(std::string("cannot resize scratch file for the stored frames: ") + std::strerror(errno) );
+  void* ptr=mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  if( ptr==MAP_FAILED ) plumed_merror(std::string("cannot map scratch file for the stored frames: ") + std::strerror(errno) );
+  base=static_cast<double*>( ptr ); mapped=bytes;
+  // Move the frames that were kept in memory so far
+  if( !memory.empty() ) {
+    std::copy( memory.begin(), memory.begin()+size_t(nframes)*nfeatures, base );
+    std::vector<double>().swap(memory);
+  }
+#else
+  plumed_merror("cannot spill the stored frames to a scratch file as PLUMED was compiled without mmap");
+#endif
+}
+
+void FrameStore::unmapScratchFile() {
+#ifdef __PLUMED_HAS_MMAP
+  if( mapped>0 ) { munmap( base, mapped ); base=NULL; }
+#endif
+  mapped=0;
+}
+
+}
+}
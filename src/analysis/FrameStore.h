@@ -0,0 +1,133 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2012-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_analysis_FrameStore_h
+#define __PLUMED_analysis_FrameStore_h
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace PLMD {
+namespace analysis {
+
+/**
+\ingroup TOOLBOX
+Class for storing the frames collected by an analysis action.
+
+The values of the features (e.g. the arguments) of all the frames are stored
+row by row in a single contiguous matrix, so that they can be traversed quickly,
+together with the weight of each frame.
+If a memory budget is set and the matrix becomes larger than the budget, the matrix
+is moved to a scratch file that is mapped in memory. The operating system
+can then keep in memory only the frames that are actually being used.
+The scratch file is removed as soon as it is created, so that it
+disappears when the store is destroyed or the program ends.
+*/
+class FrameStore {
+/// Number of features in each frame
+  unsigned nfeatures;
+/// Number of frames
+  unsigned nframes;
+/// Number of frames that fit in the allocated space
+  size_t capacity;
+/// Memory budget in bytes (zero means no limit)
+  size_t budget;
+/// Directory where the scratch file is created
+  std::string scratchdir;
+/// Storage used when the matrix is kept in memory
+  std::vector<double> memory;
+/// Pointer to the first element of the matrix
+  double* base;
+/// Descriptor of the scratch file (-1 when the matrix is kept in memory)
+  int fd;
+/// Size of the mapped region in bytes
+  size_t mapped;
+/// The weights of the frames
+  std::vector<double> weights;
+/// Make space for at least n frames
+  void reserve( size_t n );
+/// Map the scratch file, making it large enough for n frames
+  void mapScratchFile( size_t n );
+/// Remove the mapping of the scratch file
+  void unmapScratchFile();
+public:
+  FrameStore();
+  ~FrameStore();
+  FrameStore(const FrameStore&) = delete;
+  FrameStore& operator=(const FrameStore&) = delete;
+/// Returns true if the matrix can be spilled to a memory mapped file
+  static bool canSpill();
+/// Set the number of features in each frame.  This removes all the frames
+  void setNumberOfFeatures( const unsigned& n );
+/// Set the memory budget in bytes (zero means no limit) and the directory for the scratch file
+  void setMemoryBudget( const size_t& bytes, const std::string& dir );
+/// Change the number of frames. New frames are set to zero and have unit weight
+  void resize( const unsigned& n );
+/// Get the number of frames
+  unsigned size() const ;
+/// Get the number of features in each frame
+  unsigned getNumberOfFeatures() const ;
+/// Set the values of the features of frame i
+  void setFrame( const unsigned& i, const std::vector<double>& values );
+/// Get a pointer to the values of the features of frame i
+  const double* getFrame( const unsigned& i ) const ;
+/// Set the weight of frame i
+  void setWeight( const unsigned& i, const double& w );
+/// Get the weight of frame i
+  double getWeight( const unsigned& i ) const ;
+/// Returns true if the matrix is stored in a memory mapped file
+  bool isSpilled() const ;
+};
+
+inline
+unsigned FrameStore::size() const {
+  return nframes;
+}
+
+inline
+unsigned FrameStore::getNumberOfFeatures() const {
+  return nfeatures;
+}
+
+inline
+const double* FrameStore::getFrame( const unsigned& i ) const {
+  return base+size_t(i)*nfeatures;
+}
+
+inline
+void FrameStore::setWeight( const unsigned& i, const double& w ) {
+  weights[i]=w;
+}
+
+inline
+double FrameStore::getWeight( const unsigned& i ) const {
+  return weights[i];
+}
+
+inline
+bool FrameStore::isSpilled() const {
+  return fd>=0;
+}
+
+}
+}
+#endif
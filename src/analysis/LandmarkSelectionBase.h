@@ -52,6 +52,8 @@ private:
   AnalysisWithLandmarks* action;
 /// How do we treat weights
   bool novoronoi, noweights;
+/// Buffer used to copy frames that are kept in the frame store
+  std::unique_ptr<ReferenceConfiguration> framebuffer;
 protected:
 /// Return the numbe of landmarks
   unsigned getNumberOfLandmarks() const ;
@@ -144,10 +144,13 @@ void PCA::performAnalysis() {
   MultiValue myval( 1, getNumberOfArguments() + 3*getNumberOfAtoms() + 9 );
   ReferenceValuePack mypack( getNumberOfArguments(), getNumberOfAtoms(), myval );
   for(unsigned i=0; i<getNumberOfAtoms(); ++i) mypack.setAtomIndex( i, i );
+  // Get the first frame and a buffer for the other frames
+  std::unique_ptr<ReferenceConfiguration> firstbuffer, framebuffer;
+  ReferenceConfiguration* first=getStoredConfiguration( 0, firstbuffer );
   // Setup some PCA storage
-  data[0]->setupPCAStorage ( mypack ); std::vector<double> displace( getNumberOfAtoms() );
+  first->setupPCAStorage ( mypack ); std::vector<double> displace( getNumberOfAtoms() );
   if( getNumberOfAtoms()>0 ) {
-    ReferenceAtoms* at = dynamic_cast<ReferenceAtoms*>( data[0].get() );
+    ReferenceAtoms* at = dynamic_cast<ReferenceAtoms*>( first );
     displace = at->getDisplace();
   }
 
@@ -159,7 +162,8 @@ void PCA::performAnalysis() {
   // Calculate the average displacement from the first frame
   double norm=getWeight(0);
   for(unsigned i=1; i<getNumberOfDataPoints(); ++i) {
-    data[0]->calc( data[i]->getReferencePositions(), getPbc(), getArguments(), data[i]->getReferenceArguments(), mypack, true );
+    ReferenceConfiguration* myframe=getStoredConfiguration( i, framebuffer );
+    first->calc( myframe->getReferencePositions(), getPbc(), getArguments(), myframe->getReferenceArguments(), mypack, true );
     // Accumulate average displacement of arguments (Here PBC could do fucked up things - really needs Berry Phase ) GAT
     for(unsigned j=0; j<getNumberOfArguments(); ++j) sarg[j] += 0.5*getWeight(i)*mypack.getArgumentDerivative(j);
     // Accumulate average displacement of position
@@ -168,8 +172,8 @@ void PCA::performAnalysis() {
   }
   // Now normalise the displacements to get the average and add these to the first frame
   double inorm = 1.0 / norm ;
-  for(unsigned j=0; j<getNumberOfArguments(); ++j) sarg[j] = inorm*sarg[j] + data[0]->getReferenceArguments()[j];
-  for(unsigned j=0; j<getNumberOfAtoms(); ++j) spos[j] = inorm*spos[j] + data[0]->getReferencePositions()[j];
+  for(unsigned j=0; j<getNumberOfArguments(); ++j) sarg[j] = inorm*sarg[j] + first->getReferenceArguments()[j];
+  for(unsigned j=0; j<getNumberOfAtoms(); ++j) spos[j] = inorm*spos[j] + first->getReferencePositions()[j];
   // And set the reference configuration
   std::vector<double> empty( getNumberOfArguments(), 1.0 ); myref->setReferenceConfig( spos, sarg, empty );
 
@@ -178,22 +182,23 @@ void PCA::performAnalysis() {
   Matrix<double> covar( getNumberOfArguments()+3*getNumberOfAtoms(), getNumberOfArguments()+3*getNumberOfAtoms() ); covar=0;
   for(unsigned i=0; i<getNumberOfDataPoints(); ++i) {
     // double d = data[i]->calc( spos, getPbc(), getArguments(), sarg, mypack, true );
-    data[0]->calc( data[i]->getReferencePositions(), getPbc(), getArguments(), data[i]->getReferenceArguments(), mypack, true );
+    ReferenceConfiguration* myframe=getStoredConfiguration( i, framebuffer );
+    first->calc( myframe->getReferencePositions(), getPbc(), getArguments(), myframe->getReferenceArguments(), mypack, true );
     for(unsigned jarg=0; jarg<getNumberOfArguments(); ++jarg) {
       // Need sorting for PBC with GAT
-      double jarg_d = 0.5*mypack.getArgumentDerivative(jarg) + data[0]->getReferenceArguments()[jarg] - sarg[jarg];
+      double jarg_d = 0.5*mypack.getArgumentDerivative(jarg) + first->getReferenceArguments()[jarg] - sarg[jarg];
       for(unsigned karg=0; karg<getNumberOfArguments(); ++karg) {
         // Need sorting for PBC with GAT
-        double karg_d = 0.5*mypack.getArgumentDerivative(karg) + data[0]->getReferenceArguments()[karg] - sarg[karg];
+        double karg_d = 0.5*mypack.getArgumentDerivative(karg) + first->getReferenceArguments()[karg] - sarg[karg];
         covar( jarg, karg ) += 0.25*getWeight(i)*jarg_d*karg_d; // mypack.getArgumentDerivative(jarg)*mypack.getArgumentDerivative(karg);
       }
     }
     for(unsigned jat=0; jat<getNumberOfAtoms(); ++jat) {
       for(unsigned jc=0; jc<3; ++jc) {
-        double jdisplace = mypack.getAtomsDisplacementVector()[jat][jc] / displace[jat] + data[0]->getReferencePositions()[jat][jc] - spos[jat][jc];
+        double jdisplace = mypack.getAtomsDisplacementVector()[jat][jc] / displace[jat] + first->getReferencePositions()[jat][jc] - spos[jat][jc];
         for(unsigned kat=0; kat<getNumberOfAtoms(); ++kat) {
           for(unsigned kc=0; kc<3; ++kc) {
-            double kdisplace = mypack.getAtomsDisplacementVector()[kat][kc] / displace[kat] + data[0]->getReferencePositions()[kat][kc] - spos[kat][kc];
+            double kdisplace = mypack.getAtomsDisplacementVector()[kat][kc] / displace[kat] + first->getReferencePositions()[kat][kc] - spos[kat][kc];
             covar( narg+3*jat + jc, narg+3*kat + kc ) += getWeight(i)*jdisplace*kdisplace;
           }
         }
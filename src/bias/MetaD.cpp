@@ -36,6 +36,9 @@
 #include <limits>
 #include <ctime>
 #include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <random>
 
 #define DP2CUTOFF 6.25
 
@@ -233,6 +236,26 @@ where all the walkers are located. WALKERS_RSTRIDE is the number of step between
 one update and the other. Since version 2.2.5, hills files are automatically
 flushed every WALKERS_RSTRIDE steps.
 
+When many walkers share the same filesystem, parsing the text hills files of the
+other walkers can become expensive. With the WALKERS_BINARY flag each walker additionally
+writes its hills in a binary file (named as the hills file with the suffix .bin)
+made of fixed-size records preceded by a header containing the number of records
+written so far. The other walkers then only read the records that were
+appended since their last read, without any text parsing. Text hills files are still
+written and are the ones used upon restart. Binary files are not portable across
+machines with different endianness and, when not restarting, are backed up as the other output files.
+\plumedfile
+DISTANCE ATOMS=3,5 LABEL=d1
+METAD ...
+   ARG=d1 SIGMA=0.05 HEIGHT=0.3 PACE=500 LABEL=restraint
+   WALKERS_N=64
+   WALKERS_ID=3
+   WALKERS_DIR=../
+   WALKERS_RSTRIDE=100
+   WALKERS_BINARY
+... METAD
+\endplumedfile
+
 \par
 The c(t) reweighting factor can be calculated on the fly using the equations
 presented in \cite Tiwary_jp504920s as described above.
@@ -387,6 +410,17 @@ private:
   string mw_dir_;
   int mw_id_;
   int mw_rstride_;
+  bool mw_binary_;
+/// binary file where this walker appends its hills (only on rank 0)
+  FILE* mw_bin_ofile_;
+/// generation of the binary file of each walker when it was last read (only on rank 0)
+  vector<std::int64_t> mw_bin_generation_;
+/// number of hills of each walker already read, counted from the beginning of its text hills file
+  vector<std::int64_t> mw_bin_nread_;
+/// number of hills of this walker preceding the first record of its binary file
+  std::int64_t mw_bin_first_;
+  std::int64_t mw_bin_nwritten_;
+  unsigned mw_bin_reclen_;
   bool walkers_mpi;
   unsigned mpi_nw_;
   unsigned mpi_mw_;
@@ -413,8 +447,12 @@ private:
   static void   registerTemperingKeywords(const std::string &name_stem, const std::string &name, Keywords &keys);
   void   readTemperingSpecs(TemperingSpecs &t_specs);
   void   logTemperingSpecs(const TemperingSpecs &t_specs);
-  void   readGaussians(IFile*);
+  unsigned readGaussians(IFile*);
   void   writeGaussian(const Gaussian&,OFile&);
+  void   openBinaryHills();
+  bool   readBinaryHeader(FILE*, const string&, std::int64_t&, std::int64_t&, std::int64_t&);
+  void   writeBinaryGaussian(const Gaussian&);
+  void   readBinaryGaussians(unsigned iwalker);
   void   addGaussian(const Gaussian&);
   double getHeight(const vector<double>&);
   void   temperHeight(double &height, const TemperingSpecs &t_specs, const double tempering_bias);
@@ -429,6 +467,7 @@ private:
 
 public:
   explicit MetaD(const ActionOptions&);
+  ~MetaD();
   void calculate();
   void update();
   static void registerKeywords(Keywords& keys);
@@ -482,6 +521,7 @@ void MetaD::registerKeywords(Keywords& keys) {
   keys.add("optional","WALKERS_N", "number of walkers");
   keys.add("optional","WALKERS_DIR", "shared directory with the hills files from all the walkers");
   keys.add("optional","WALKERS_RSTRIDE","stride for reading hills files");
+  keys.addFlag("WALKERS_BINARY",false,"exchange hills among filesystem multiple walkers through append-only binary files rather than by parsing the text hills files");
   keys.add("optional","INTERVAL","monodimensional lower and upper limits, outside the limits the system will not feel the biasing force.");
   keys.add("optional","SIGMA_MAX","the upper bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
   keys.add("optional","SIGMA_MIN","the lower bounds for the sigmas (in CV units) when using adaptive hills. Negative number means no bounds ");
@@ -517,6 +557,7 @@ MetaD::MetaD(const ActionOptions& ao):
   adaptive_(FlexibleBin::none),
 // Multiple walkers initialization
   mw_n_(1), mw_dir_(""), mw_id_(0), mw_rstride_(1),
+  mw_binary_(false), mw_bin_ofile_(NULL), mw_bin_first_(0), mw_bin_nwritten_(0), mw_bin_reclen_(0),
   walkers_mpi(false), mpi_nw_(0), mpi_mw_(0),
   acceleration(false), acc(0.0), acc_restart_mean_(0.0),
   calc_max_bias_(false), max_bias_(0.0),
@@ -747,6 +788,7 @@ MetaD::MetaD(const ActionOptions& ao):
   if(mw_n_<=mw_id_) error("walker ID should be a numerical value less than the total number of walkers");
   parse("WALKERS_DIR",mw_dir_);
   parse("WALKERS_RSTRIDE",mw_rstride_);
+  parseFlag("WALKERS_BINARY",mw_binary_);
 
   // MPI version
   parseFlag("WALKERS_MPI",walkers_mpi);
@@ -864,7 +906,9 @@ MetaD::MetaD(const ActionOptions& ao):
     log.printf("  walker id %d\n",mw_id_);
     log.printf("  reading stride %d\n",mw_rstride_);
     if(mw_dir_!="")log.printf("  directory with hills files %s\n",mw_dir_.c_str());
+    if(mw_binary_) log.printf("  hills are exchanged through binary files\n");
   } else {
+    if(mw_binary_) error("WALKERS_BINARY can only be used with WALKERS_N");
     if(walkers_mpi) {
       log.printf("  Multiple walkers active using MPI communnication\n");
       if(mw_dir_!="")log.printf("  directory with hills files %s\n",mw_dir_.c_str());
@@ -1038,6 +1082,10 @@ MetaD::MetaD(const ActionOptions& ao):
     }
   }
 
+  // number of hills read from the text file of each walker, used as a starting
+  // point when reading the binary hills files
+  if(mw_binary_) mw_bin_nread_.assign(mw_n_,0);
+
   // creating vector of ifile* for hills reading
   // open all files at the beginning and read Gaussians if restarting
   for(int i=0; i<mw_n_; ++i) {
@@ -1067,7 +1115,8 @@ MetaD::MetaD(const ActionOptions& ao):
       ifile->open(fname);
       if(getRestart()&&!restartedFromGrid) {
         log.printf("  Restarting from %s:",ifilesnames[i].c_str());
-        readGaussians(ifiles[i].get());
+        const unsigned nhills=readGaussians(ifiles[i].get());
+        if(mw_binary_) mw_bin_nread_[i]=nhills;
       }
       ifiles[i]->reset(false);
       // close only the walker own hills file for later writing
@@ -1143,6 +1192,8 @@ MetaD::MetaD(const ActionOptions& ao):
   // output periodicities of variables
   for(unsigned i=0; i<getNumberOfArguments(); ++i) hillsOfile_.setupPrintValue( getPntrToArgument(i) );
 
+  if(mw_binary_) openBinaryHills();
+
   bool concurrent=false;
   const ActionSet&actionSet(plumed.getActionSet());
   for(const auto & p : actionSet) if(dynamic_cast<MetaD*>(p.get())) { concurrent=true; break; }
@@ -1213,7 +1264,148 @@ void MetaD::logTemperingSpecs(const TemperingSpecs &t_specs) {
   if (t_specs.alpha != 1.0) log.printf("  %s decay shape parameter alpha %f\n", t_specs.name.c_str(), t_specs.alpha);
 }
 
-void MetaD::readGaussians(IFile *ifile)
+MetaD::~MetaD() {
+  if(mw_bin_ofile_) std::fclose(mw_bin_ofile_);
+}
+
+// Layout of the binary hills files: a header made of six 64-bit integers
+// (magic number, number of arguments, record length, generation, number of hills
+// of the walker preceding the first record and number of records)
+// followed by records of mw_bin_reclen_ doubles, each containing the center,
+// the sigma (padded to the length of the multivariate case), the height and the multivariate flag.
+// Writers first append the record and then update the number of records in the header,
+// so that readers never see partial records. The generation is a random number chosen
+// when the file is created, so that readers can detect files that have been recreated.
+static const std::int64_t mw_bin_magic=0x504c4d4448494c4cLL;
+static const unsigned mw_bin_header_size=6;
+
+void MetaD::openBinaryHills()
+{
+  const unsigned ncv=getNumberOfArguments();
+  mw_bin_reclen_=ncv+ncv*(ncv+1)/2+2;
+  mw_bin_generation_.assign(mw_n_,0);
+  const string fname=ifilesnames[mw_id_]+".bin";
+  log.printf("  Writing binary hills on %s\n",fname.c_str());
+  if(comm.Get_rank()!=0) return;
+// when restarting, the binary file is only extended if its records follow the
+// hills read from the text file, otherwise a new one is started after them
+  if(getRestart()) {
+    mw_bin_ofile_=std::fopen(fname.c_str(),"r+b");
+    std::int64_t generation;
+    if(mw_bin_ofile_ && !(readBinaryHeader(mw_bin_ofile_,fname,generation,mw_bin_first_,mw_bin_nwritten_)
+                          && mw_bin_first_+mw_bin_nwritten_==mw_bin_nread_[mw_id_])) {
+      std::fclose(mw_bin_ofile_); mw_bin_ofile_=NULL;
+    }
+  }
+  if(!mw_bin_ofile_) {
+    hillsOfile_.backupFile("bck",fname);
+    mw_bin_ofile_=std::fopen(fname.c_str(),"w+b");
+    if(!mw_bin_ofile_) error("cannot open binary hills file " + fname);
+    std::random_device rd;
+    std::int64_t generation=0;
+    while(generation==0) generation=(static_cast<std::int64_t>(rd())<<32)^rd();
+    mw_bin_first_=(getRestart()?mw_bin_nread_[mw_id_]:0);
+    mw_bin_nwritten_=0;
+    std::int64_t header[mw_bin_header_size]= {mw_bin_magic,ncv,mw_bin_reclen_,generation,mw_bin_first_,0};
+    if(std::fwrite(header,sizeof(header[0]),mw_bin_header_size,mw_bin_ofile_)!=mw_bin_header_size) error("cannot write on binary hills file " + fname);
+    std::fflush(mw_bin_ofile_);
+  }
+}
+
+bool MetaD::readBinaryHeader(FILE* fp, const string& fname, std::int64_t& generation, std::int64_t& first, std::int64_t& nrecords)
+{
+  std::int64_t header[mw_bin_header_size];
+  std::fseek(fp,0,SEEK_SET);
+  if(std::fread(header,sizeof(header[0]),mw_bin_header_size,fp)!=mw_bin_header_size) return false;
+  if(header[0]!=mw_bin_magic) error("file " + fname + " is not a binary hills file");
+  if(header[1]!=static_cast<std::int64_t>(getNumberOfArguments()) || header[2]!=static_cast<std::int64_t>(mw_bin_reclen_))
+    error("binary hills file " + fname + " has been written with a different number of arguments");
+  generation=header[3];
+  first=header[4];
+  nrecords=header[5];
+  return true;
+}
+
+void MetaD::writeBinaryGaussian(const Gaussian& hill)
+{
+  if(comm.Get_rank()!=0) return;
+  const unsigned ncv=getNumberOfArguments();
+  vector<double> record(mw_bin_reclen_,0.0);
+  for(unsigned i=0; i<hill.center.size(); ++i) record[i]=hill.center[i];
+  for(unsigned i=0; i<hill.sigma.size(); ++i) record[ncv+i]=hill.sigma[i];
+  record[mw_bin_reclen_-2]=hill.height;
+  record[mw_bin_reclen_-1]=(hill.multivariate?1.0:0.0);
+  const long offset=sizeof(std::int64_t)*mw_bin_header_size+sizeof(double)*mw_bin_reclen_*mw_bin_nwritten_;
+  std::fseek(mw_bin_ofile_,offset,SEEK_SET);
+  if(std::fwrite(&record[0],sizeof(double),mw_bin_reclen_,mw_bin_ofile_)!=mw_bin_reclen_) error("cannot write on binary hills file");
+  std::fflush(mw_bin_ofile_);
+  // publish the new record
+  mw_bin_nwritten_++;
+  std::fseek(mw_bin_ofile_,sizeof(std::int64_t)*(mw_bin_header_size-1),SEEK_SET);
+  if(std::fwrite(&mw_bin_nwritten_,sizeof(mw_bin_nwritten_),1,mw_bin_ofile_)!=1) error("cannot write on binary hills file");
+  std::fflush(mw_bin_ofile_);
+}
+
+void MetaD::readBinaryGaussians(unsigned iwalker)
+{
+  const unsigned ncv=getNumberOfArguments();
+  const string fname=ifilesnames[iwalker]+".bin";
+  std::int64_t start=mw_bin_nread_[iwalker];
+  unsigned nnew=0;
+  unsigned nmissing=0;
+  vector<double> buffer;
+  if(comm.Get_rank()==0) {
+// the file is opened at every read, so that files that have been
+// backed up and recreated by the other walker are detected
+    FILE* fp=std::fopen(fname.c_str(),"rb");
+    std::int64_t generation=0,first=0,nrecords=0;
+    if(fp && readBinaryHeader(fp,fname,generation,first,nrecords)) {
+      if(generation!=mw_bin_generation_[iwalker]) {
+// a file starting from the first hill contains a new history,
+// otherwise it continues the hills already read from the text file
+        if(mw_bin_generation_[iwalker]!=0 && first==0) start=0;
+        if(start<first) {
+          nmissing=first-start;
+          start=first;
+        }
+        mw_bin_generation_[iwalker]=generation;
+      } else if(first+nrecords<start) {
+// the file has been truncated
+        start=first;
+      }
+      if(first+nrecords>start) {
+        nnew=first+nrecords-start;
+        buffer.resize(nnew*mw_bin_reclen_);
+        const long offset=sizeof(std::int64_t)*mw_bin_header_size+sizeof(double)*mw_bin_reclen_*(start-first);
+        std::fseek(fp,offset,SEEK_SET);
+        nnew=std::fread(&buffer[0],sizeof(double),buffer.size(),fp)/mw_bin_reclen_;
+      }
+    }
+    if(fp) std::fclose(fp);
+  }
+  unsigned long nstart=start;
+  comm.Bcast(nstart,0);
+  comm.Bcast(nnew,0);
+// the log is written by all the processes
+  comm.Bcast(nmissing,0);
+  if(nmissing>0) log.printf("  WARNING: %u hills of walker %u are missing from %s\n",nmissing,iwalker,fname.c_str());
+  mw_bin_nread_[iwalker]=nstart+nnew;
+  if(nnew==0) return;
+  buffer.resize(nnew*mw_bin_reclen_);
+  comm.Bcast(buffer,0);
+
+  vector<double> center(ncv);
+  for(unsigned k=0; k<nnew; ++k) {
+    const double* record=&buffer[k*mw_bin_reclen_];
+    const bool multivariate=(record[mw_bin_reclen_-1]>0.5);
+    vector<double> sigma(record+ncv,record+ncv+(multivariate?ncv*(ncv+1)/2:ncv));
+    for(unsigned i=0; i<ncv; ++i) center[i]=record[i];
+    addGaussian(Gaussian(center,sigma,record[mw_bin_reclen_-2],multivariate));
+  }
+  log.printf("  Reading hills from %s:      %u Gaussians read\n",fname.c_str(),nnew);
+}
+
+unsigned MetaD::readGaussians(IFile *ifile)
 {
   unsigned ncv=getNumberOfArguments();
   vector<double> center(ncv);
@@ -1233,6 +1425,7 @@ void MetaD::readGaussians(IFile *ifile)
     addGaussian(Gaussian(center,sigma,height,multivariate));
   }
   log.printf("      %d Gaussians read\n",nhills);
+  return nhills;
 }
 
 void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
@@ -1650,6 +1843,7 @@ void MetaD::update() {
       addGaussian(newhill);
       // print on HILLS file
       writeGaussian(newhill,hillsOfile_);
+      if(mw_binary_) writeBinaryGaussian(newhill);
     }
   }
 
@@ -1692,6 +1886,10 @@ void MetaD::update() {
     for(int i=0; i<mw_n_; ++i) {
       // don't read your own Gaussians
       if(i==mw_id_) continue;
+      if(mw_binary_) {
+        readBinaryGaussians(i);
+        continue;
+      }
       // if the file is not open yet
       if(!(ifiles[i]->isOpen())) {
         // check if it exists now and open it!
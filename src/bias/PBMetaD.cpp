@@ -29,6 +29,7 @@
 #include "core/FlexibleBin.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/OpenMP.h"
 #include <string>
 #include <cstring>
 #include "tools/File.h"
@@ -270,7 +271,9 @@ private:
   void   readGaussians(unsigned iarg, IFile*);
   void   writeGaussian(unsigned iarg, const Gaussian&, OFile*);
   void   addGaussian(unsigned iarg, const Gaussian&);
+  void   addGaussians(const vector<Gaussian>&);
   double getBiasAndDerivatives(unsigned iarg, const vector<double>&, double* der=NULL);
+  void   getAllBiasAndDerivatives(const vector<double>&, vector<double>&, vector<double>* der=NULL);
   double evaluateGaussian(unsigned iarg, const vector<double>&, const Gaussian&,double* der=NULL);
   vector<unsigned> getGaussianSupport(unsigned iarg, const Gaussian&);
   bool   scanOneHill(unsigned iarg, IFile *ifile,  vector<Value> &v, vector<double> &center, vector<double>  &sigma, double &height, bool &multivariate);
@@ -851,6 +854,55 @@ void PBMetaD::addGaussian(unsigned iarg, const Gaussian& hill)
   }
 }
 
+/// adds one hill per argument. Grids of different arguments are independent and are
+/// updated in parallel; with more than one rank the values on the support of all the
+/// hills are reduced with a single collective
+void PBMetaD::addGaussians(const vector<Gaussian>& hills)
+{
+  const unsigned ncv=getNumberOfArguments();
+  plumed_dbg_assert(hills.size()==ncv);
+  if(!grid_ || comm.Get_size()==1) {
+    #pragma omp parallel for num_threads(OpenMP::getNumThreads())
+    for(unsigned i=0; i<ncv; ++i) addGaussian(i, hills[i]);
+    return;
+  }
+
+  vector<vector<Grid::index_t> > neighbors(ncv);
+  vector<unsigned> offset(ncv+1,0);
+  for(unsigned i=0; i<ncv; ++i) {
+    neighbors[i]=BiasGrids_[i]->getNeighbors(hills[i].center,getGaussianSupport(i, hills[i]));
+    offset[i+1]=offset[i]+neighbors[i].size();
+  }
+  const unsigned ntot=offset[ncv];
+  // values in the first half, derivatives in the second one
+  vector<double> allbias(2*ntot,0.0);
+  unsigned stride=comm.Get_size();
+  unsigned rank=comm.Get_rank();
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    vector<double> xx(1);
+    #pragma omp for
+    for(unsigned i=0; i<ncv; ++i) {
+      for(unsigned k=rank; k<neighbors[i].size(); k+=stride) {
+        BiasGrids_[i]->getPoint(neighbors[i][k],xx);
+        allbias[offset[i]+k]=evaluateGaussian(i,xx,hills[i],&allbias[ntot+offset[i]+k]);
+      }
+    }
+  }
+  comm.Sum(allbias);
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    vector<double> der(1);
+    #pragma omp for
+    for(unsigned i=0; i<ncv; ++i) {
+      for(unsigned k=0; k<neighbors[i].size(); ++k) {
+        der[0]=allbias[ntot+offset[i]+k];
+        BiasGrids_[i]->addValueAndDerivatives(neighbors[i][k],allbias[offset[i]+k],der);
+      }
+    }
+  }
+}
+
 vector<unsigned> PBMetaD::getGaussianSupport(unsigned iarg, const Gaussian& hill)
 {
   vector<unsigned> nneigh;
@@ -877,6 +929,8 @@ vector<unsigned> PBMetaD::getGaussianSupport(unsigned iarg, const Gaussian& hill
   return nneigh;
 }
 
+/// returns the bias on argument iarg; without grids only the hills assigned to this rank
+/// are summed and the reduction is left to the caller (see getAllBiasAndDerivatives)
 double PBMetaD::getBiasAndDerivatives(unsigned iarg, const vector<double>& cv, double* der)
 {
   double bias=0.0;
@@ -886,8 +940,6 @@ double PBMetaD::getBiasAndDerivatives(unsigned iarg, const vector<double>& cv, d
     for(unsigned i=rank; i<hills_[iarg].size(); i+=stride) {
       bias += evaluateGaussian(iarg,cv,hills_[iarg][i],der);
     }
-    comm.Sum(bias);
-    if(der) comm.Sum(der,1);
   } else {
     if(der) {
       vector<double> vder(1);
@@ -901,6 +953,28 @@ double PBMetaD::getBiasAndDerivatives(unsigned iarg, const vector<double>& cv, d
   return bias;
 }
 
+/// computes the bias (and optionally its derivative) on all the arguments at once.
+/// Arguments are independent, so they are distributed over threads, and without grids
+/// the partial sums of all the arguments are reduced with a single collective
+void PBMetaD::getAllBiasAndDerivatives(const vector<double>& cv, vector<double>& bias, vector<double>* der)
+{
+  const unsigned ncv=getNumberOfArguments();
+  // bias and derivatives are packed in a single buffer so as to have one reduction only
+  vector<double> buffer(der?2*ncv:ncv,0.0);
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    vector<double> cv_tmp(1);
+    #pragma omp for
+    for(unsigned i=0; i<ncv; ++i) {
+      cv_tmp[0] = cv[i];
+      buffer[i] = getBiasAndDerivatives(i, cv_tmp, der?&buffer[ncv+i]:NULL);
+    }
+  }
+  if(!grid_ && comm.Get_size()>1) comm.Sum(buffer);
+  bias.assign(buffer.begin(),buffer.begin()+ncv);
+  if(der) der->assign(buffer.begin()+ncv,buffer.end());
+}
+
 double PBMetaD::evaluateGaussian(unsigned iarg, const vector<double>& cv, const Gaussian& hill, double* der)
 {
   double bias=0.0;
@@ -946,18 +1020,15 @@ void PBMetaD::calculate()
   // on adaptive hills (diff) after exchanges:
   if(adaptive_==FlexibleBin::diffusion && getExchangeStep()) error("ADAPTIVE=DIFF is not compatible with replica exchange");
 
-  vector<double> cv(1);
-  double der[1];
+  vector<double> cv(getNumberOfArguments());
   vector<double> bias(getNumberOfArguments());
   vector<double> deriv(getNumberOfArguments());
+  for(unsigned i=0; i<getNumberOfArguments(); ++i) cv[i] = getArgument(i);
+  getAllBiasAndDerivatives(cv, bias, &deriv);
 
   double ncv = (double) getNumberOfArguments();
   double bmin = 1.0e+19;
   for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-    cv[0]    = getArgument(i);
-    der[0]   = 0.0;
-    bias[i]  = getBiasAndDerivatives(i, cv, der);
-    deriv[i] = der[0];
     if(bias[i] < bmin) bmin = bias[i];
   }
   double ene = 0.;
@@ -997,6 +1068,7 @@ void PBMetaD::update()
 
   // if you use adaptive, call the FlexibleBin
   if(adaptive_!=FlexibleBin::none) {
+    #pragma omp parallel for num_threads(OpenMP::getNumThreads())
     for(unsigned i=0; i<getNumberOfArguments(); i++) flexbin[i].update(nowAddAHill,i);
     multivariate=true;
   } else {
@@ -1005,78 +1077,78 @@ void PBMetaD::update()
 
   if(nowAddAHill && (!do_select_ || (do_select_ && select_value_==current_value_))) {
     // get all biases and heights
-    vector<double> cv(getNumberOfArguments());
-    vector<double> bias(getNumberOfArguments());
-    vector<double> thissigma(getNumberOfArguments());
-    vector<double> height(getNumberOfArguments());
+    const unsigned ncv=getNumberOfArguments();
+    vector<double> cv(ncv);
+    vector<double> bias(ncv);
+    vector<double> thissigma(ncv);
+    vector<double> height(ncv);
     vector<double> cv_tmp(1);
     vector<double> sigma_tmp(1);
     double norm = 0.0;
     double bmin = 1.0e+19;
-    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    for(unsigned i=0; i<ncv; ++i) {
       if(adaptive_!=FlexibleBin::none) thissigma[i]=flexbin[i].getInverseMatrix(i)[0];
       else thissigma[i]=sigma0_[i];
       cv[i]     = getArgument(i);
-      cv_tmp[0] = getArgument(i);
-      bias[i] = getBiasAndDerivatives(i, cv_tmp);
+    }
+    getAllBiasAndDerivatives(cv, bias);
+    for(unsigned i=0; i<ncv; ++i) {
       if(bias[i] < bmin) bmin = bias[i];
     }
     // calculate heights and norm
-    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    for(unsigned i=0; i<ncv; ++i) {
       double h = exp((-bias[i]+bmin)/kbt_);
       norm += h;
       height[i] = h;
     }
     // normalize and apply welltemp correction
-    for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+    for(unsigned i=0; i<ncv; ++i) {
       height[i] *=  height0_ / norm;
       if(welltemp_) height[i] *= exp(-bias[i]/(kbt_*(biasf_-1.0)));
     }
 
+    vector<Gaussian> newhills;
+    newhills.reserve(ncv);
     // MPI Multiple walkers: share hills and add them all
     if(walkers_mpi) {
-      // Allocate arrays to store all walkers hills
-      std::vector<double> all_cv(mpi_nw_*cv.size(), 0.0);
-      std::vector<double> all_sigma(mpi_nw_*getNumberOfArguments(), 0.0);
-      std::vector<double> all_height(mpi_nw_*height.size(), 0.0);
+      // Allocate a single array to store centers, sigmas and heights of all walkers hills,
+      // so that they are exchanged with one collective
+      const unsigned nw=mpi_nw_*ncv;
+      std::vector<double> all_hills(3*nw, 0.0);
       if(comm.Get_rank()==0) {
         // fill in value
-        for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-          unsigned j = mpi_id_ * getNumberOfArguments() + i;
-          all_cv[j] = cv[i];
-          all_sigma[j]  = thissigma[i];
-          all_height[j] = height[i];
+        for(unsigned i=0; i<ncv; ++i) {
+          unsigned j = mpi_id_ * ncv + i;
+          all_hills[j]      = cv[i];
+          all_hills[nw+j]   = thissigma[i];
+          all_hills[2*nw+j] = height[i];
         }
         // Communicate (only root)
-        multi_sim_comm.Sum(&all_cv[0], all_cv.size());
-        multi_sim_comm.Sum(&all_sigma[0], all_sigma.size());
-        multi_sim_comm.Sum(&all_height[0], all_height.size());
+        multi_sim_comm.Sum(all_hills);
       }
       // Share info with group members
-      comm.Sum(&all_cv[0], all_cv.size());
-      comm.Sum(&all_sigma[0], all_sigma.size());
-      comm.Sum(&all_height[0], all_height.size());
-      // now add hills one by one
+      comm.Sum(all_hills);
+      // now add hills walker by walker
       for(unsigned j=0; j<mpi_nw_; ++j) {
-        for(unsigned i=0; i<getNumberOfArguments(); ++i) {
-          cv_tmp[0]    = all_cv[j*cv.size()+i];
-          double height_tmp = all_height[j*cv.size()+i];
-          sigma_tmp[0] = all_sigma[j*cv.size()+i];
-          Gaussian newhill = Gaussian(cv_tmp, sigma_tmp, height_tmp, multivariate);
-          addGaussian(i, newhill);
-          writeGaussian(i, newhill, hillsOfiles_[i].get());
+        newhills.clear();
+        for(unsigned i=0; i<ncv; ++i) {
+          cv_tmp[0]    = all_hills[j*ncv+i];
+          sigma_tmp[0] = all_hills[nw+j*ncv+i];
+          newhills.push_back(Gaussian(cv_tmp, sigma_tmp, all_hills[2*nw+j*ncv+i], multivariate));
         }
+        addGaussians(newhills);
+        for(unsigned i=0; i<ncv; ++i) writeGaussian(i, newhills[i], hillsOfiles_[i].get());
       }
       // just add your own hills
     } else {
-      for(unsigned i=0; i<getNumberOfArguments(); ++i) {
+      for(unsigned i=0; i<ncv; ++i) {
         cv_tmp[0] = cv[i];
         if(adaptive_!=FlexibleBin::none) sigma_tmp[0]=thissigma[i];
         else sigma_tmp[0] = sigma0_[i];
-        Gaussian newhill = Gaussian(cv_tmp, sigma_tmp, height[i], multivariate);
-        addGaussian(i, newhill);
-        writeGaussian(i, newhill, hillsOfiles_[i].get());
+        newhills.push_back(Gaussian(cv_tmp, sigma_tmp, height[i], multivariate));
       }
+      addGaussians(newhills);
+      for(unsigned i=0; i<ncv; ++i) writeGaussian(i, newhills[i], hillsOfiles_[i].get());
     }
   }
 
@@ -856,9 +856,8 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
 
       }
 
-      p.cmd("setStepLong",&step);
-      p.cmd("setStopFlag",&plumedStopCondition);
-
+// all the per-step pointers are passed at once, in the order documented for setStepData
+      void* stepData[8]= {&step,&cell[0],NULL,NULL,NULL,NULL,&virial[0],NULL};
       if(debug_dd) {
         for(int i=0; i<dd_nlocal; ++i) {
           int kk=dd_gatindex[i];
@@ -866,22 +865,22 @@ int Driver<real>::main(FILE* in,FILE*out,Communicator& pc) {
           dd_coordinates[3*i+1]=coordinates[3*kk+1];
           dd_coordinates[3*i+2]=coordinates[3*kk+2];
         }
-        p.cmd("setForces",&dd_forces[0]);
-        p.cmd("setPositions",&dd_coordinates[0]);
-        p.cmd("setMasses",&dd_masses[0]);
-        p.cmd("setCharges",&dd_charges[0]);
+        stepData[2]=&dd_coordinates[0];
+        stepData[3]=&dd_masses[0];
+        stepData[4]=&dd_charges[0];
+        stepData[5]=&dd_forces[0];
       } else {
 // this is required to avoid troubles when the last domain
 // contains zero atoms
 // Basically, for empty domains we pass null pointers
 #define fix_pd(xx) (pd_nlocal!=0?&xx:NULL)
-        p.cmd("setForces",fix_pd(forces[3*pd_start]));
-        p.cmd("setPositions",fix_pd(coordinates[3*pd_start]));
-        p.cmd("setMasses",fix_pd(masses[pd_start]));
-        p.cmd("setCharges",fix_pd(charges[pd_start]));
+        stepData[2]=fix_pd(coordinates[3*pd_start]);
+        stepData[3]=fix_pd(masses[pd_start]);
+        stepData[4]=fix_pd(charges[pd_start]);
+        stepData[5]=fix_pd(forces[3*pd_start]);
       }
-      p.cmd("setBox",&cell[0]);
-      p.cmd("setVirial",&virial[0]);
+      p.cmd("setStepData",stepData);
+      p.cmd("setStopFlag",&plumedStopCondition);
     } else {
       p.cmd("setStepLong",&step);
       p.cmd("setStopFlag",&plumedStopCondition);
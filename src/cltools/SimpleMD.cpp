@@ -24,11 +24,14 @@
 #include "wrapper/Plumed.h"
 #include "tools/Vector.h"
 #include "tools/Random.h"
+#include "tools/OpenMP.h"
+#include "tools/Communicator.h"
 #include <string>
 #include <cstdio>
 #include <cmath>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 using namespace std;
 
@@ -71,6 +74,28 @@ input file will be output.
 plumed simplemd --help
 \endverbatim
 
+The neighbour list is built using cell lists, so that simplemd can be used to
+simulate systems with a large number of atoms. The neighbour list and the
+Lennard-Jones forces are computed using the number of openMP threads set with the
+PLUMED_NUM_THREADS environment variable. The result does not depend on the number of
+threads used for the neighbour list, whereas forces might differ in the last digits.
+
+Setting dd to true, atoms are passed to PLUMED as an MD code using domain decomposition
+would do: each MPI process only passes the atoms in a slab of the box, and the
+atoms are reassigned to the processes every time the neighbour list is recomputed.
+The dynamics is integrated on all the processes, so this is only useful to test
+the performance and the correctness of PLUMED with domain decomposition.
+For instance, the following command runs simplemd with four emulated domains:
+\verbatim
+mpirun -np 4 plumed simplemd in
+\endverbatim
+where the file in contains the line
+\verbatim
+dd true
+\endverbatim
+Notice that in this case the input file should be passed as an argument, since
+the standard input might not be available on all the processes.
+
 */
 //+ENDPLUMEDOC
 
@@ -103,6 +128,7 @@ public:
     keys.add("compulsory","idum","0","The random number seed");
     keys.add("compulsory","ndim","3","The dimensionality of the system (some interesting LJ clusters are two dimensional)");
     keys.add("compulsory","wrapatoms","false","If true, atomic coordinates are written wrapped in minimal cell");
+    keys.add("compulsory","dd","false","If true, atoms are passed to plumed with an emulated domain decomposition, with one domain per MPI process");
   }
 
   explicit SimpleMD( const CLToolOptions& co ) :
@@ -127,6 +153,7 @@ private:
              int&    nconfig,
              int&    nstat,
              bool&   wrapatoms,
+             bool&   dd,
              string& inputfile,
              string& outputfile,
              string& trajfile,
@@ -186,6 +213,10 @@ private:
     parse("wrapatoms",w);
     wrapatoms=false;
     if(w.length()>0 && (w[0]=='T' || w[0]=='t')) wrapatoms=true;
+    std::string d;
+    parse("dd",d);
+    dd=false;
+    if(d.length()>0 && (d[0]=='T' || d[0]=='t')) dd=true;
   }
 
   void read_natoms(const string & inputfile,int & natoms) {
@@ -249,34 +280,121 @@ private:
   }
 
 
+  void compute_cells(const int natoms,const vector<Vector>& positions,const double cell[3],const double listcutoff,
+                     int ncell[3],vector<int>& atomcell,vector<int>& cellstart,vector<int>& cellatoms) {
+// assign atoms to cells whose side is not smaller than the list cutoff
+// atoms in cell c are cellatoms[cellstart[c]] ... cellatoms[cellstart[c+1]-1]
+    for(int k=0; k<3; k++) {
+      ncell[k]=int(floor(cell[k]/listcutoff));
+      if(ncell[k]<1) ncell[k]=1;
+    }
+    const int ntot=ncell[0]*ncell[1]*ncell[2];
+    atomcell.resize(natoms);
+    cellstart.assign(ntot+1,0);
+    for(int iatom=0; iatom<natoms; iatom++) {
+      int c[3];
+      for(int k=0; k<3; k++) {
+        double s=positions[iatom][k]/cell[k];
+        s-=floor(s);
+        c[k]=int(s*ncell[k]);
+// rounding could bring s*ncell[k] to ncell[k]
+        if(c[k]>=ncell[k]) c[k]=ncell[k]-1;
+      }
+      atomcell[iatom]=(c[0]*ncell[1]+c[1])*ncell[2]+c[2];
+      cellstart[atomcell[iatom]+1]++;
+    }
+    for(int c=0; c<ntot; c++) cellstart[c+1]+=cellstart[c];
+    vector<int> next(cellstart.begin(),cellstart.end()-1);
+    cellatoms.resize(natoms);
+    for(int iatom=0; iatom<natoms; iatom++) cellatoms[next[atomcell[iatom]]++]=iatom;
+  }
+
   void compute_list(const int natoms,const int listsize,const vector<Vector>& positions,const double cell[3],const double listcutoff,
-                    vector<int>& point,vector<int>& list) {
+                    vector<int>& point,vector<int>& list,vector<int>& cellatoms) {
 // see Allen-Tildesey for a definition of point and list
-    Vector distance;     // distance of the two atoms
-    Vector distance_pbc; // minimum-image distance of the two atoms
+// neighbours are searched in the neighbouring cells only, and are stored in increasing order
+// so that the list is identical to the one obtained looping on all the pairs
     double listcutoff2;  // squared list cutoff
     listcutoff2=listcutoff*listcutoff;
+    int ncell[3];
+    vector<int> atomcell,cellstart;
+    compute_cells(natoms,positions,cell,listcutoff,ncell,atomcell,cellstart,cellatoms);
+// the list is built in two passes, first counting and then storing the neighbours,
+// so that atoms can be processed in parallel
+    vector<int> count(natoms,0);
     point[0]=0;
-    for(int iatom=0; iatom<natoms-1; iatom++) {
-      point[iatom+1]=point[iatom];
-      for(int jatom=iatom+1; jatom<natoms; jatom++) {
-        for(int k=0; k<3; k++) distance[k]=positions[iatom][k]-positions[jatom][k];
-        pbc(cell,distance,distance_pbc);
+    for(int pass=0; pass<2; pass++) {
+      #pragma omp parallel num_threads(OpenMP::getNumThreads())
+      {
+        vector<int> neighbours;
+        vector<int> cells;
+        Vector distance;     // distance of the two atoms
+        Vector distance_pbc; // minimum-image distance of the two atoms
+        #pragma omp for schedule(dynamic,64)
+        for(int iatom=0; iatom<natoms-1; iatom++) {
+          const int c=atomcell[iatom];
+          const int ci[3]= {c/(ncell[1]*ncell[2]),(c/ncell[2])%ncell[1],c%ncell[2]};
+// with less than three cells along a direction the same cell would be found more than once
+          cells.clear();
+          for(int dx=-1; dx<=1; dx++) for(int dy=-1; dy<=1; dy++) for(int dz=-1; dz<=1; dz++) {
+                const int nc=(((ci[0]+dx+ncell[0])%ncell[0])*ncell[1]+(ci[1]+dy+ncell[1])%ncell[1])*ncell[2]+(ci[2]+dz+ncell[2])%ncell[2];
+                if(find(cells.begin(),cells.end(),nc)==cells.end()) cells.push_back(nc);
+              }
+          neighbours.clear();
+          for(unsigned ic=0; ic<cells.size(); ic++) for(int j=cellstart[cells[ic]]; j<cellstart[cells[ic]+1]; j++) {
+              const int jatom=cellatoms[j];
+              if(jatom<=iatom) continue;
+              for(int k=0; k<3; k++) distance[k]=positions[iatom][k]-positions[jatom][k];
+              pbc(cell,distance,distance_pbc);
 // if the interparticle distance is larger than the cutoff, skip
-        double d2=0; for(int k=0; k<3; k++) d2+=distance_pbc[k]*distance_pbc[k];
-        if(d2>listcutoff2)continue;
-        if(point[iatom+1]>listsize) {
+              double d2=0; for(int k=0; k<3; k++) d2+=distance_pbc[k]*distance_pbc[k];
+              if(d2>listcutoff2)continue;
+              neighbours.push_back(jatom);
+            }
+          if(pass==0) {
+            count[iatom]=neighbours.size();
+          } else {
+            sort(neighbours.begin(),neighbours.end());
+            for(unsigned j=0; j<neighbours.size(); j++) list[point[iatom]+j]=neighbours[j];
+          }
+        }
+      }
+      if(pass==0) {
+        for(int iatom=0; iatom<natoms-1; iatom++) point[iatom+1]=point[iatom]+count[iatom];
+        if(natoms>0 && point[natoms-1]>listsize) {
 // too many neighbours
           fprintf(stderr,"%s","Verlet list size exceeded\n");
           fprintf(stderr,"%s","Increase maxneighbours\n");
           exit(1);
         }
-        list[point[iatom+1]]=jatom;
-        point[iatom+1]++;
       }
     }
   }
 
+  void assign_domains(const int natoms,const vector<Vector>& positions,const double cell[3],const vector<int>& cellatoms,
+                      const int ndomains,const int domain,vector<int>& gatindex) {
+// emulate a domain decomposition with one slab along x per process.
+// local atoms are stored in cell order, as an MD code would do
+    gatindex.clear();
+    for(int i=0; i<natoms; i++) {
+      const int iatom=cellatoms[i];
+      double s=positions[iatom][0]/cell[0];
+      s-=floor(s);
+      int d=int(s*ndomains);
+      if(d>=ndomains) d=ndomains-1;
+      if(d==domain) gatindex.push_back(iatom);
+    }
+  }
+
+  void reassign_domains(Plumed& plumed,const int natoms,const vector<Vector>& positions,const double cell[3],
+                        const vector<int>& cellatoms,Communicator& pc,vector<int>& gatindex) {
+// pass the new domain decomposition to plumed
+    assign_domains(natoms,positions,cell,cellatoms,pc.Get_size(),pc.Get_rank(),gatindex);
+    int nlocal=gatindex.size();
+    plumed.cmd("setAtomsNlocal",&nlocal);
+    plumed.cmd("setAtomsGatindex",nlocal>0?&gatindex[0]:NULL);
+  }
+
   void compute_forces(const int natoms,const int listsize,const vector<Vector>& positions,const double cell[3],
                       double forcecutoff,const vector<int>& point,const vector<int>& list,vector<Vector>& forces,double & engconf)
   {
@@ -291,25 +409,45 @@ private:
     engconf=0.0;
     for(int i=0; i<natoms; i++)for(int k=0; k<3; k++) forces[i][k]=0.0;
     engcorrection=4.0*(1.0/pow(forcecutoff2,6.0)-1.0/pow(forcecutoff2,3));
-    for(int iatom=0; iatom<natoms-1; iatom++) {
-      for(int jlist=point[iatom]; jlist<point[iatom+1]; jlist++) {
-        int jatom=list[jlist];
-        for(int k=0; k<3; k++) distance[k]=positions[iatom][k]-positions[jatom][k];
-        pbc(cell,distance,distance_pbc);
-        distance_pbc2=0.0; for(int k=0; k<3; k++) distance_pbc2+=distance_pbc[k]*distance_pbc[k];
+    const unsigned nt=OpenMP::getNumThreads();
+// the first thread accumulates directly on forces, the others on private arrays
+// which are then added in a fixed order, so that the result does not depend on scheduling.
+// this is necessary to keep the trajectories identical on all processes when using dd
+    vector<vector<Vector> > omp_forces(nt>1?nt-1:0);
+    vector<double> omp_engconf(nt,0.0);
+    #pragma omp parallel num_threads(nt) private(distance,distance_pbc,distance_pbc2,f)
+    {
+      const unsigned rank=OpenMP::getThreadNum();
+      if(rank>0) omp_forces[rank-1].assign(natoms,Vector());
+      vector<Vector> & myforces(rank>0?omp_forces[rank-1]:forces);
+      double & myengconf(omp_engconf[rank]);
+      #pragma omp for schedule(static)
+      for(int iatom=0; iatom<natoms-1; iatom++) {
+        for(int jlist=point[iatom]; jlist<point[iatom+1]; jlist++) {
+          int jatom=list[jlist];
+          for(int k=0; k<3; k++) distance[k]=positions[iatom][k]-positions[jatom][k];
+          pbc(cell,distance,distance_pbc);
+          distance_pbc2=0.0; for(int k=0; k<3; k++) distance_pbc2+=distance_pbc[k]*distance_pbc[k];
 // if the interparticle distance is larger than the cutoff, skip
-        if(distance_pbc2>forcecutoff2) continue;
-        double distance_pbc6=distance_pbc2*distance_pbc2*distance_pbc2;
-        double distance_pbc8=distance_pbc6*distance_pbc2;
-        double distance_pbc12=distance_pbc6*distance_pbc6;
-        double distance_pbc14=distance_pbc12*distance_pbc2;
-        engconf+=4.0*(1.0/distance_pbc12 - 1.0/distance_pbc6) - engcorrection;
-        for(int k=0; k<3; k++) f[k]=2.0*distance_pbc[k]*4.0*(6.0/distance_pbc14-3.0/distance_pbc8);
+          if(distance_pbc2>forcecutoff2) continue;
+          double distance_pbc6=distance_pbc2*distance_pbc2*distance_pbc2;
+          double distance_pbc8=distance_pbc6*distance_pbc2;
+          double distance_pbc12=distance_pbc6*distance_pbc6;
+          double distance_pbc14=distance_pbc12*distance_pbc2;
+          myengconf+=4.0*(1.0/distance_pbc12 - 1.0/distance_pbc6) - engcorrection;
+          for(int k=0; k<3; k++) f[k]=2.0*distance_pbc[k]*4.0*(6.0/distance_pbc14-3.0/distance_pbc8);
 // same force on the two atoms, with opposite sign:
-        for(int k=0; k<3; k++) forces[iatom][k]+=f[k];
-        for(int k=0; k<3; k++) forces[jatom][k]-=f[k];
+          for(int k=0; k<3; k++) myforces[iatom][k]+=f[k];
+          for(int k=0; k<3; k++) myforces[jatom][k]-=f[k];
+        }
       }
     }
+    if(omp_forces.size()>0) {
+      #pragma omp parallel for num_threads(nt)
+      for(int iatom=0; iatom<natoms; iatom++) for(unsigned t=0; t<omp_forces.size(); t++)
+          if(omp_forces[t].size()>0) forces[iatom]+=omp_forces[t][iatom];
+    }
+    for(unsigned t=0; t<nt; t++) engconf+=omp_engconf[t];
   }
 
   void compute_engkin(const int natoms,const vector<double>& masses,const vector<Vector>& velocities,double & engkin)
@@ -415,6 +553,14 @@ private:
     vector<int>    list;         // neighbour list
     vector<int>    point;        // pointer to neighbour list
     vector<Vector> positions0;   // reference atomic positions, i.e. positions when the neighbour list
+    vector<int>    cellatoms;    // atoms sorted by cell, as computed when the neighbour list is built
+
+// emulated domain decomposition variables
+    vector<int>    dd_gatindex;  // global indexes of the local atoms
+    vector<Vector> dd_positions; // positions of the local atoms
+    vector<double> dd_masses;    // masses of the local atoms
+    vector<Vector> dd_forces;    // forces on the local atoms
+    vector<Vector> dd_allforces; // forces on all the atoms, summed over the domains
 
 // input parameters
 // all of them have a reasonable default value, set in read_input()
@@ -431,6 +577,7 @@ private:
     int         idum;              // seed
     int         plumedWantsToStop; // stop flag
     bool        wrapatoms;         // if true, atomic coordinates are written wrapped in minimal cell
+    bool        dd;                // if true, atoms are passed to plumed with an emulated domain decomposition
     string      inputfile;         // name of file with starting configuration (xyz)
     string      outputfile;        // name of file with final configuration (xyz)
     string      trajfile;          // name of the trajectory file (xyz)
@@ -456,7 +603,7 @@ private:
 
     read_input(temperature,tstep,friction,forcecutoff,
                listcutoff,nstep,nconfig,nstat,
-               wrapatoms,inputfile,outputfile,trajfile,statfile,
+               wrapatoms,dd,inputfile,outputfile,trajfile,statfile,
                maxneighbour,ndim,idum);
 
 // number of atoms is read from file inputfile
@@ -480,6 +627,11 @@ private:
     fprintf(out,"%s %d\n","Dimensionality                   :",ndim);
     fprintf(out,"%s %d\n","Seed                             :",idum);
     fprintf(out,"%s %s\n","Are atoms wrapped on output?     :",(wrapatoms?"T":"F"));
+    fprintf(out,"%s %s\n","Emulated domain decomposition?   :",(dd?"T":"F"));
+    fprintf(out,"%s %u\n","Number of openMP threads         :",OpenMP::getNumThreads());
+
+// with dd, every process integrates the whole system, so only the first one writes files
+    const bool writefiles=(!dd || pc.Get_rank()==0);
 
 // Setting the seed
     random.setSeed(idum);
@@ -515,6 +667,7 @@ private:
       plumed->cmd("setMDEngine","simpleMD");
       plumed->cmd("setTimestep",&tstep);
       plumed->cmd("setPlumedDat","plumed.dat");
+      if(dd && Communicator::initialized()) plumed->cmd("setMPIComm",&pc.Get_comm());
       int pversion=0;
       plumed->cmd("getApiVersion",&pversion);
 // setting kbT is only implemented with api>1
@@ -527,11 +680,14 @@ private:
     }
 
 // neighbour list are computed, and reference positions are saved
-    compute_list(natoms,listsize,positions,cell,listcutoff,point,list);
+    compute_list(natoms,listsize,positions,cell,listcutoff,point,list,cellatoms);
 
     fprintf(out,"List size: %d\n",point[natoms-1]);
     for(int iatom=0; iatom<natoms; ++iatom) for(int k=0; k<3; ++k) positions0[iatom][k]=positions[iatom][k];
 
+// domains are assigned together with the neighbour list, as in MD codes
+    if(plumed && dd) reassign_domains(*plumed,natoms,positions,cell,cellatoms,pc,dd_gatindex);
+
 // forces are computed before starting md
     compute_forces(natoms,listsize,positions,cell,forcecutoff,point,list,forces,engconf);
 
@@ -562,10 +718,11 @@ private:
 // a check is performed to decide whether to recalculate the neighbour list
       check_list(natoms,positions,positions0,listcutoff,forcecutoff,recompute_list);
       if(recompute_list) {
-        compute_list(natoms,listsize,positions,cell,listcutoff,point,list);
+        compute_list(natoms,listsize,positions,cell,listcutoff,point,list,cellatoms);
         for(int iatom=0; iatom<natoms; ++iatom) for(int k=0; k<3; ++k) positions0[iatom][k]=positions[iatom][k];
         fprintf(out,"Neighbour list recomputed at step %d\n",istep);
         fprintf(out,"List size: %d\n",point[natoms-1]);
+        if(plumed && dd) reassign_domains(*plumed,natoms,positions,cell,cellatoms,pc,dd_gatindex);
       }
 
       compute_forces(natoms,listsize,positions,cell,forcecutoff,point,list,forces,engconf);
@@ -576,14 +733,37 @@ private:
         for(int i=0; i<3; i++)for(int k=0; k<3; k++) cell9[i][k]=0.0;
         for(int i=0; i<3; i++) cell9[i][i]=cell[i];
         plumed->cmd("setStep",&istepplusone);
-        plumed->cmd("setMasses",&masses[0]);
-        plumed->cmd("setForces",&forces[0]);
+        if(dd) {
+// only the local atoms are passed, in the local order
+          const int nlocal=dd_gatindex.size();
+          dd_positions.resize(nlocal);
+          dd_masses.resize(nlocal);
+          dd_forces.resize(nlocal);
+          for(int i=0; i<nlocal; i++) {
+            dd_positions[i]=positions[dd_gatindex[i]];
+            dd_masses[i]=masses[dd_gatindex[i]];
+            dd_forces[i]=forces[dd_gatindex[i]];
+          }
+          plumed->cmd("setMasses",nlocal>0?&dd_masses[0]:NULL);
+          plumed->cmd("setForces",nlocal>0?&dd_forces[0]:NULL);
+          plumed->cmd("setPositions",nlocal>0?&dd_positions[0]:NULL);
+        } else {
+          plumed->cmd("setMasses",&masses[0]);
+          plumed->cmd("setForces",&forces[0]);
+          plumed->cmd("setPositions",&positions[0]);
+        }
         plumed->cmd("setEnergy",&engconf);
-        plumed->cmd("setPositions",&positions[0]);
         plumed->cmd("setBox",cell9);
         plumed->cmd("setStopFlag",&plumedWantsToStop);
         plumed->cmd("calc");
         if(plumedWantsToStop) nstep=istep;
+        if(dd) {
+// each atom belongs to a single domain, so that the sum is exact
+          dd_allforces.assign(natoms,Vector());
+          for(unsigned i=0; i<dd_gatindex.size(); i++) dd_allforces[dd_gatindex[i]]=dd_forces[i];
+          pc.Sum(dd_allforces);
+          forces=dd_allforces;
+        }
       }
 // remove forces if ndim<3
       if(ndim<3)
@@ -598,13 +778,13 @@ private:
       compute_engkin(natoms,masses,velocities,engkin);
 
 // eventually, write positions and statistics
-      if((istep+1)%nconfig==0) write_positions(trajfile,natoms,positions,cell,wrapatoms);
-      if((istep+1)%nstat==0)   write_statistics(statfile,istep+1,tstep,natoms,ndim,engkin,engconf,engint);
+      if(writefiles && (istep+1)%nconfig==0) write_positions(trajfile,natoms,positions,cell,wrapatoms);
+      if(writefiles && (istep+1)%nstat==0)   write_statistics(statfile,istep+1,tstep,natoms,ndim,engkin,engconf,engint);
 
     }
 
 // write final positions
-    write_final_positions(outputfile,natoms,positions,cell,wrapatoms);
+    if(writefiles) write_final_positions(outputfile,natoms,positions,cell,wrapatoms);
 
 // close the statistic file if it was open:
     if(write_statistics_fp) fclose(write_statistics_fp);
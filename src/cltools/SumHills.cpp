@@ -98,6 +98,18 @@ You can use a --stride keyword to have a dump each bunch of hills you read
 plumed sum_hills --stride 300 --hills PATHTOMYHILLSFILE
 \endverbatim
 
+The free energy is accumulated as the hills are read, so that each dump only adds
+the hills read since the previous one.
+The hills are distributed among MPI processes and OpenMP threads (set with the
+PLUMED_NUM_THREADS environment variable), each of them summing its share on a private
+copy of the grid. Thus, for long runs it might be convenient to use
+
+\verbatim
+PLUMED_NUM_THREADS=8 mpirun -np 4 plumed sum_hills --stride 300 --hills PATHTOMYHILLSFILE
+\endverbatim
+
+Notice that in this case each thread holds a copy of the whole grid.
+
 You can also have, in case of welltempered metadynamics, only the negative
 bias instead of the free energy through the keyword --negbias
 
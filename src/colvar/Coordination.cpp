@@ -51,6 +51,14 @@ but it can be changed using the optional SWITCH option.
 To make your calculation faster you can use a neighbor list, which makes it that only a
 relevant subset of the pairwise distance are calculated at every step.
 
+For very large groups, the MIXED_PRECISION flag can be used to compute distances
+and switching functions in single precision. The coordination number and its
+derivatives are still accumulated in double precision, so that the error is
+of the order of the single precision accuracy on each pair (relative error of about 1e-6).
+Notice that only rational switching functions with M=2N and D_0=0 (which is the default)
+are evaluated in single precision, the others being computed in double precision
+from single precision distances.
+
 If GROUPB is empty, it will sum the \f$\frac{N(N-1)}{2}\f$ pairs in GROUPA. This avoids computing
 twice permuted indexes (e.g. pair (i,j) and (j,i)) thus running at twice the speed.
 
@@ -91,6 +99,16 @@ c2: COMBINE ARG=x COEFFICIENTS=2
 PRINT ARG=c1,c2 STRIDE=10
 \endplumedfile
 
+The flag PAIR_STATISTICS can be used to check how much work is done and to tune
+the neighbor list parameters. The coordination is then stored in the component value,
+and the number of tested pairs, the number of pairs within the cutoff of the switching function,
+the size of the neighbor list and the time spent updating it are stored in further components.
+These numbers are also written in the log every time the neighbor list is updated.
+\plumedfile
+c: COORDINATION GROUPA=1-1000 SWITCH={RATIONAL R_0=0.3 D_MAX=0.8} NLIST NL_CUTOFF=1.0 NL_STRIDE=20 PAIR_STATISTICS
+PRINT ARG=c.value,c.npairs,c.ninside,c.nlsize,c.nltime STRIDE=10
+\endplumedfile
+
 
 
 */
@@ -104,6 +122,8 @@ public:
 // active methods:
   static void registerKeywords( Keywords& keys );
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const;
+  virtual float pairingFloat(float distance,float&dfunc,unsigned i,unsigned j)const;
+  virtual double getPairingCutoff()const;
 };
 
 PLUMED_REGISTER_ACTION(Coordination,"COORDINATION")
@@ -153,6 +173,16 @@ double Coordination::pairing(double distance,double&dfunc,unsigned i,unsigned j)
   return switchingFunction.calculateSqr(distance,dfunc);
 }
 
+float Coordination::pairingFloat(float distance,float&dfunc,unsigned i,unsigned j)const {
+  (void) i; // avoid warnings
+  (void) j; // avoid warnings
+  return switchingFunction.calculateSqr(distance,dfunc);
+}
+
+double Coordination::getPairingCutoff()const {
+  return switchingFunction.get_dmax();
+}
+
 }
 
 }
@@ -25,6 +25,9 @@
 #include "tools/OpenMP.h"
 
 #include <string>
+#include <cmath>
+#include <chrono>
+#include <limits>
 
 using namespace std;
 
@@ -38,19 +41,33 @@ void CoordinationBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NLIST",false,"Use a neighbour list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbour list");
   keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbour list");
+  keys.addFlag("MIXED_PRECISION",false,"Compute distances and pairing functions in single precision, while accumulating the result and its derivatives in double precision. "
+               "This is faster for large groups, at the price of a relative accuracy of about 1e-6 on each pair");
+  keys.addFlag("PAIR_STATISTICS",false,"Store as components the number of pairs that are tested, the number of pairs within the cutoff, "
+               "the size of the neighbor list and the time spent updating it. These numbers are also written on the log whenever the neighbor list is updated");
   keys.add("atoms","GROUPA","First list of atoms");
   keys.add("atoms","GROUPB","Second list of atoms (if empty, N*(N-1)/2 pairs in GROUPA are counted)");
+  keys.addOutputComponent("npairs","PAIR_STATISTICS","the number of pairs whose distance has been computed in this step");
+  keys.addOutputComponent("ninside","PAIR_STATISTICS","the number of pairs within the cutoff of the pairing function in this step");
+  keys.addOutputComponent("nlsize","PAIR_STATISTICS","the number of pairs currently in the neighbor list");
+  keys.addOutputComponent("nltime","PAIR_STATISTICS","the time in seconds spent in the last update of the neighbor list");
 }
 
 CoordinationBase::CoordinationBase(const ActionOptions&ao):
   PLUMED_COLVAR_INIT(ao),
   pbc(true),
   serial(false),
+  mixedPrecision(false),
   invalidateList(true),
-  firsttime(true)
+  firsttime(true),
+  pairStatistics(false),
+  listUpdated(false),
+  nlUpdateTime(0.0)
 {
 
   parseFlag("SERIAL",serial);
+  parseFlag("MIXED_PRECISION",mixedPrecision);
+  parseFlag("PAIR_STATISTICS",pairStatistics);
 
   vector<AtomNumber> ga_lista,gb_lista;
   parseAtomList("GROUPA",ga_lista);
@@ -77,6 +94,12 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   }
 
   addValueWithDerivatives(); setNotPeriodic();
+  if(pairStatistics) {
+    addComponent("npairs"); componentIsNotPeriodic("npairs");
+    addComponent("ninside"); componentIsNotPeriodic("ninside");
+    addComponent("nlsize"); componentIsNotPeriodic("nlsize");
+    addComponent("nltime"); componentIsNotPeriodic("nltime");
+  }
   if(gb_lista.size()>0) {
     if(doneigh)  nl.reset( new NeighborList(ga_lista,gb_lista,dopair,pbc,getPbc(),nl_cut,nl_st) );
     else         nl.reset( new NeighborList(ga_lista,gb_lista,dopair,pbc,getPbc()) );
@@ -102,6 +125,8 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   if(pbc) log.printf("  using periodic boundary conditions\n");
   else    log.printf("  without periodic boundary conditions\n");
   if(dopair) log.printf("  with PAIR option\n");
+  if(mixedPrecision) log.printf("  pairs are computed in single precision\n");
+  if(pairStatistics) log.printf("  storing pair statistics as components\n");
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
     log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
@@ -112,6 +137,17 @@ CoordinationBase::~CoordinationBase() {
 // destructor required to delete forward declared class
 }
 
+float CoordinationBase::pairingFloat(float distance,float&dfunc,unsigned i,unsigned j)const {
+  double ddfunc=0.0;
+  double result=pairing(distance,ddfunc,i,j);
+  dfunc=ddfunc;
+  return result;
+}
+
+double CoordinationBase::getPairingCutoff()const {
+  return std::numeric_limits<double>::max();
+}
+
 void CoordinationBase::prepare() {
   if(nl->getStride()>0) {
     if(firsttime || (getStep()%nl->getStride()==0)) {
@@ -136,8 +172,11 @@ void CoordinationBase::calculate()
   vector<Vector> deriv(getNumberOfAtoms());
 // deriv.resize(getPositions().size());
 
-  if(nl->getStride()>0 && invalidateList) {
+  const bool updateList=(nl->getStride()>0 && invalidateList);
+  if(updateList) {
+    const auto start=std::chrono::steady_clock::now();
     nl->update(getPositions());
+    nlUpdateTime=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
   }
 
   unsigned stride=comm.Get_size();
@@ -157,12 +196,44 @@ void CoordinationBase::calculate()
   if(nt*stride*10>nn) nt=nn/stride/10;
   if(nt==0)nt=1;
 
+// pairs beyond the cutoff of the pairing function are rejected as soon as
+// one of the components of their distance is too large
+  const double dmax=getPairingCutoff();
+  const double dmax2=(dmax<std::sqrt(std::numeric_limits<double>::max())?dmax*dmax:std::numeric_limits<double>::max());
+  const bool orthoPbc=(pbc && getPbc().isSet() && getPbc().isOrthorombic());
+
+// in mixed precision, positions are converted once and minimum image
+// is done in single precision for orthorhombic boxes
+  bool floatPbc=false;
+  float box[3]= {0.0f,0.0f,0.0f};
+  float invbox[3]= {0.0f,0.0f,0.0f};
+  const float fdmax=(dmax<std::numeric_limits<float>::max()?dmax:std::numeric_limits<float>::max());
+  if(mixedPrecision) {
+    const unsigned natoms=getNumberOfAtoms();
+    fpositions.resize(3*natoms);
+    for(unsigned i=0; i<natoms; i++) {
+      const Vector & p(getPosition(i));
+      fpositions[3*i+0]=p[0];
+      fpositions[3*i+1]=p[1];
+      fpositions[3*i+2]=p[2];
+    }
+    floatPbc=orthoPbc;
+    if(floatPbc) for(unsigned k=0; k<3; k++) {
+        box[k]=getBox()(k,k);
+        invbox[k]=1.0f/box[k];
+      }
+  }
+  const bool floatDistance=(mixedPrecision && (floatPbc || !pbc || !getPbc().isSet()));
+
+  unsigned long npairs=0;
+  unsigned long ninside=0;
+
   #pragma omp parallel num_threads(nt)
   {
     std::vector<Vector> omp_deriv(getPositions().size());
     Tensor omp_virial;
 
-    #pragma omp for reduction(+:ncoord) nowait
+    #pragma omp for reduction(+:ncoord,npairs,ninside) nowait
     for(unsigned int i=rank; i<nn; i+=stride) {
 
       Vector distance;
@@ -171,14 +242,60 @@ void CoordinationBase::calculate()
 
       if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
 
-      if(pbc) {
-        distance=pbcDistance(getPosition(i0),getPosition(i1));
-      } else {
-        distance=delta(getPosition(i0),getPosition(i1));
-      }
+      npairs++;
 
       double dfunc=0.;
-      ncoord += pairing(distance.modulo2(), dfunc,i0,i1);
+      if(floatDistance) {
+        float d[3];
+        bool inside=true;
+        for(unsigned k=0; k<3; k++) {
+          d[k]=fpositions[3*i1+k]-fpositions[3*i0+k];
+          if(floatPbc) d[k]-=box[k]*std::floor(d[k]*invbox[k]+0.5f);
+          if(std::fabs(d[k])>fdmax) {
+            inside=false;
+            break;
+          }
+        }
+        if(!inside) continue;
+        const float d2=d[0]*d[0]+d[1]*d[1]+d[2]*d[2];
+        if(d2>dmax2) continue;
+        ninside++;
+        float fdfunc=0.0f;
+        ncoord += pairingFloat(d2,fdfunc,i0,i1);
+        dfunc=fdfunc;
+        distance=Vector(d[0],d[1],d[2]);
+      } else {
+        if(orthoPbc) {
+// same minimum image as Pbc::distance, done one component at a time
+          const Vector & p0(getPosition(i0));
+          const Vector & p1(getPosition(i1));
+          const Tensor & bb(getPbc().getBox());
+          const Tensor & ib(getPbc().getInvBox());
+          bool inside=true;
+          for(unsigned k=0; k<3; k++) {
+            distance[k]=Tools::pbc((p1[k]-p0[k])*ib(k,k))*bb(k,k);
+            if(std::fabs(distance[k])>dmax) {
+              inside=false;
+              break;
+            }
+          }
+          if(!inside) continue;
+        } else if(pbc) {
+          distance=pbcDistance(getPosition(i0),getPosition(i1));
+        } else {
+          distance=delta(getPosition(i0),getPosition(i1));
+        }
+        const double d2=distance.modulo2();
+        if(d2>dmax2) continue;
+        ninside++;
+        if(mixedPrecision) {
+          float fdfunc=0.0f;
+          ncoord += pairingFloat(d2,fdfunc,i0,i1);
+          dfunc=fdfunc;
+        } else {
+          ncoord += pairing(d2, dfunc,i0,i1);
+        }
+      }
 
       Vector dd(dfunc*distance);
       Tensor vv(dd,distance);
@@ -204,12 +321,34 @@ void CoordinationBase::calculate()
     comm.Sum(ncoord);
     if(!deriv.empty()) comm.Sum(&deriv[0][0],3*deriv.size());
     comm.Sum(virial);
+    if(pairStatistics) {
+      comm.Sum(npairs);
+      comm.Sum(ninside);
+    }
   }
 
   for(unsigned i=0; i<deriv.size(); ++i) setAtomsDerivatives(i,deriv[i]);
   setValue           (ncoord);
   setBoxDerivatives  (virial);
 
+  if(pairStatistics) {
+    getPntrToComponent("npairs")->set(npairs);
+    getPntrToComponent("ninside")->set(ninside);
+    getPntrToComponent("nlsize")->set(nn);
+    getPntrToComponent("nltime")->set(nlUpdateTime);
+    listUpdated=updateList;
+  }
+
+}
+
+// the log is written here since actions might be calculated concurrently
+void CoordinationBase::update() {
+  if(pairStatistics && listUpdated) {
+    log.printf("  %s at step %ld: neighbor list with %u pairs updated in %f seconds, %lu pairs tested and %lu within the cutoff\n",
+               getLabel().c_str(),getStep(),static_cast<unsigned>(getPntrToComponent("nlsize")->get()),getPntrToComponent("nltime")->get(),
+               static_cast<unsigned long>(getPntrToComponent("npairs")->get()),static_cast<unsigned long>(getPntrToComponent("ninside")->get()));
+    listUpdated=false;
+  }
 }
 }
 }
@@ -33,9 +33,18 @@ namespace colvar {
 class CoordinationBase : public Colvar {
   bool pbc;
   bool serial;
+  bool mixedPrecision;
+/// positions converted to single precision, used when mixedPrecision is set
+  std::vector<float> fpositions;
   std::unique_ptr<NeighborList> nl;
   bool invalidateList;
   bool firsttime;
+/// if true, pair counters are stored as components
+  bool pairStatistics;
+/// true if the neighbor list has been updated in this step, used to log pair counters
+  bool listUpdated;
+/// time spent in the last update of the neighbor list, in seconds
+  double nlUpdateTime;
 
 public:
   explicit CoordinationBase(const ActionOptions&);
@@ -43,7 +52,14 @@ public:
 // active methods:
   virtual void calculate();
   virtual void prepare();
+  virtual void update();
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const=0;
+/// Single precision version of pairing(), used with MIXED_PRECISION.
+/// The default implementation calls the double precision one.
+  virtual float pairingFloat(float distance,float&dfunc,unsigned i,unsigned j)const;
+/// Distance beyond which pairing() is exactly zero, used to reject pairs early.
+/// The default implementation returns the largest representable double.
+  virtual double getPairingCutoff()const;
   static void registerKeywords( Keywords& keys );
 };
 
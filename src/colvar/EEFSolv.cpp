@@ -28,7 +28,10 @@
 #include "core/PlumedMain.h"
 #include "core/SetupMolInfo.h"
 #include "tools/OpenMP.h"
+#include "tools/LinkCells.h"
+#include "tools/Pbc.h"
 #include <initializer_list>
+#include <algorithm>
 
 #define INV_PI_SQRT_PI 0.179587122
 #define KCAL_TO_KJ 4.184
@@ -54,7 +57,7 @@ where \f$\Delta G^\mathrm{solv}_i\f$ is the free energy of solvation, \f$\Delta
 \f]
 where \f$\Delta G^\mathrm{free}_i\f$ is the solvation free energy of the isolated group, \f$\lambda_i\f$ is the correlation length equal to the width of the first solvation shell and \f$R_i\f$ is the van der Waals radius of atom \f$i\f$.
 
-The output from this collective variable, the free energy of solvation, can be used with the \ref BIASVALUE keyword to provide implicit solvation to a system. All parameters are designed to be used with a modified CHARMM36 force field. It takes only non-hydrogen atoms as input, these can be conveniently specified using the \ref GROUP action with the NDX_GROUP parameter. To speed up the calculation, EEFSOLV internally uses a neighbourlist with a cutoff dependent on the type of atom (maximum of 1.95 nm). This cutoff can be extended further by using the NL_BUFFER keyword.
+The output from this collective variable, the free energy of solvation, can be used with the \ref BIASVALUE keyword to provide implicit solvation to a system. All parameters are designed to be used with a modified CHARMM36 force field. It takes only non-hydrogen atoms as input, these can be conveniently specified using the \ref GROUP action with the NDX_GROUP parameter. To speed up the calculation, EEFSOLV internally uses a neighbourlist with a cutoff dependent on the type of atom (maximum of 1.95 nm). This cutoff can be extended further by using the NL_BUFFER keyword. The neighbourlist is built using link cells and is updated every NL_STRIDE steps, or earlier if any atom has moved by more than half of NL_BUFFER since the last update. A large NL_STRIDE can thus be used safely, provided that NL_BUFFER is not too small.
 
 \par Examples
 
@@ -84,13 +87,22 @@ private:
   double delta_g_ref;
   unsigned stride;
   unsigned nl_update;
-  vector<vector<unsigned> > nl;
-  vector<vector<bool> > nlexpo;
+/// the cutoff used to build the neighbourlist, including the buffer
+  double nl_cutoff;
+/// neighbourlist in compressed row format: the neighbours j>i of atom i
+/// are stored in nl[nl_start[i]] ... nl[nl_start[i+1]-1]
+  vector<unsigned> nl_start;
+  vector<unsigned> nl;
+/// positions of the atoms when the neighbourlist was last updated
+  vector<Vector> nl_positions;
+  LinkCells linkcells;
   vector<vector<double> > parameter;
   void setupConstants(const vector<AtomNumber> &atoms, vector<vector<double> > &parameter, bool tcorr);
   map<string, map<string, string> > setupTypeMap();
   map<string, vector<double> > setupValueMap();
   void update_neighb();
+/// check if any atom moved by more than half of the buffer since the last update
+  bool moved_too_much() const;
 
 public:
   static void registerKeywords(Keywords& keys);
@@ -116,7 +128,9 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   buffer(0.1),
   delta_g_ref(0.),
   stride(10),
-  nl_update(0)
+  nl_update(0),
+  nl_cutoff(0.),
+  linkcells(comm)
 {
   vector<AtomNumber> atoms;
   parseAtomList("ATOMS", atoms);
@@ -135,10 +149,9 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   log << "  Bibliography " << plumed.cite("Lazaridis T, Karplus M, Proteins Struct. Funct. Genet. 35, 133 (1999)"); log << "\n";
 
 
-  nl.resize(size);
-  nlexpo.resize(size);
   parameter.resize(size, vector<double>(4, 0));
   setupConstants(atoms, parameter, tcorr);
+  for(unsigned i=0; i<size; ++i) nl_cutoff=std::max(nl_cutoff, 4./parameter[i][2] + buffer);
 
   addValueWithDerivatives();
   setNotPeriodic();
@@ -148,117 +161,188 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
 void EEFSolv::update_neighb() {
   const double lower_c2 = 0.24 * 0.24; // this is the cut-off for bonded atoms
   const unsigned size = getNumberOfAtoms();
+  const vector<Vector> & pos = getPositions();
+  nl_positions = pos;
+  nl_start.assign(size+1, 0);
+  if(size==0) { nl.clear(); return; }
+
+  // Link cells are built in an orthorhombic box enclosing all the atoms. Cells are
+  // smaller than the cutoff, so that atoms closer than the cutoff are at most
+  // nshell cells away. Pairs of distant atoms found through the periodic images
+  // of the cells are discarded below
+  const unsigned nshell = 2;
+  Vector lower = pos[0], upper = pos[0];
+  for (unsigned i=1; i<size; ++i) for(unsigned k=0; k<3; ++k) {
+      lower[k] = std::min(lower[k], pos[i][k]);
+      upper[k] = std::max(upper[k], pos[i][k]);
+    }
+  Tensor box;
+  for(unsigned k=0; k<3; ++k) box(k,k) = upper[k] - lower[k] + nl_cutoff;
+  Pbc cellpbc; cellpbc.setBox(box);
+  linkcells.setCutoff(nl_cutoff/nshell);
+  vector<unsigned> indices(size);
+  vector<double> cutoffs(size);
   for (unsigned i=0; i<size; ++i) {
-    nl[i].clear();
-    nlexpo[i].clear();
-    const Vector posi = getPosition(i);
-    // Loop through neighboring atoms, add the ones below cutoff
-    for (unsigned j=i+1; j<size; ++j) {
-      const double d2 = delta(posi, getPosition(j)).modulo2();
-      if (d2 < lower_c2 && j < i+14) {
-        // crude approximation for i-i+1/2 interactions,
-        // we want to exclude atoms separated by less than three bonds
-        continue;
-      }
-      // We choose the maximum lambda value and use a more conservative cutoff
-      double mlambda = 1./parameter[i][2];
-      if (1./parameter[j][2] > mlambda) mlambda = 1./parameter[j][2];
-      const double c2 = (4. * mlambda + buffer) * (4. * mlambda + buffer);
-      if (d2 < c2 ) {
-        nl[i].push_back(j);
-        if(parameter[i][2] == parameter[j][2] && parameter[i][3] == parameter[j][3]) {
-          nlexpo[i].push_back(true);
-        } else nlexpo[i].push_back(false);
+    indices[i] = i;
+    // We choose the maximum lambda value and use a more conservative cutoff
+    cutoffs[i] = 4. * (1./parameter[i][2]) + buffer;
+  }
+  linkcells.buildCellLists(pos, indices, cellpbc);
+
+  // Each pair of neighbouring cells is visited once, looping over the atoms of a cell
+  // and of the cells in its half shell. Every pair i<j found is stored with atom i
+  const unsigned ncells = linkcells.getNumberOfCells();
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*10>size) nt=size/10;
+  if(nt==0)nt=1;
+  vector<vector<std::pair<unsigned,unsigned> > > thread_pairs(nt);
+  #pragma omp parallel num_threads(nt)
+  {
+    vector<unsigned> cells_required;
+    vector<std::pair<unsigned,unsigned> > & mypairs = thread_pairs[OpenMP::getThreadNum()];
+    #pragma omp for schedule(static)
+    for (unsigned mycell=0; mycell<ncells; ++mycell) {
+      const unsigned natoms_cell = linkcells.getNumberOfAtomsInCell(mycell);
+      if (natoms_cell==0) continue;
+      unsigned ncells_required=0;
+      linkcells.addRequiredHalfShellCells(mycell, nshell, ncells_required, cells_required);
+      for (unsigned ka=0; ka<natoms_cell; ++ka) {
+        const unsigned a = linkcells.getAtomInCell(mycell, ka);
+        const Vector & posa = linkcells.getPositionInCell(mycell, ka);
+        // the other atoms of the same cell, then the atoms of the half shell
+        for (unsigned icell=0; icell<=ncells_required; ++icell) {
+          const unsigned cell = (icell==0 ? mycell : cells_required[icell-1]);
+          const unsigned kmax = linkcells.getNumberOfAtomsInCell(cell);
+          for (unsigned kb=(icell==0 ? ka+1 : 0); kb<kmax; ++kb) {
+            const unsigned b = linkcells.getAtomInCell(cell, kb);
+            const unsigned i = std::min(a, b), j = std::max(a, b);
+            const double d2 = delta(posa, linkcells.getPositionInCell(cell, kb)).modulo2();
+            if (d2 < lower_c2 && j < i+14) {
+              // crude approximation for i-i+1/2 interactions,
+              // we want to exclude atoms separated by less than three bonds
+              continue;
+            }
+            const double c = std::max(cutoffs[i], cutoffs[j]);
+            if (d2 < c * c) mypairs.push_back(std::make_pair(i, j));
+          }
+        }
       }
     }
   }
+
+  // The pairs are sorted in compressed row format, with the neighbours of each atom in increasing order
+  for (const auto & pairs : thread_pairs) for (const auto & p : pairs) nl_start[p.first+1]++;
+  for (unsigned i=0; i<size; ++i) nl_start[i+1] += nl_start[i];
+  nl.resize(nl_start[size]);
+  vector<unsigned> nl_fill(nl_start.begin(), nl_start.end()-1);
+  for (const auto & pairs : thread_pairs) for (const auto & p : pairs) nl[nl_fill[p.first]++] = p.second;
+  #pragma omp parallel for num_threads(nt) schedule(dynamic,64)
+  for (unsigned i=0; i<size; ++i) std::sort(nl.begin()+nl_start[i], nl.begin()+nl_start[i+1]);
+}
+
+bool EEFSolv::moved_too_much() const {
+  const unsigned size = getNumberOfAtoms();
+  if (nl_positions.size() != size) return true;
+  const double skin2 = 0.25 * buffer * buffer;
+  for (unsigned i=0; i<size; ++i) {
+    if (delta(nl_positions[i], getPosition(i)).modulo2() > skin2) return true;
+  }
+  return false;
 }
 
 void EEFSolv::calculate() {
   if(pbc) makeWhole();
   if(getExchangeStep()) nl_update = 0;
-  if (nl_update == 0) {
+  if (nl_update == 0 || moved_too_much()) {
     update_neighb();
+    nl_update = 0;
   }
 
   const unsigned size=getNumberOfAtoms();
   double bias = 0.0;
   Tensor deriv_box;
   unsigned nt=OpenMP::getNumThreads();
-  const unsigned nn=nl.size();
-  if(nt*10>nn) nt=nn/10;
+  if(nt*10>size) nt=size/10;
   if(nt==0)nt=1;
+  // Atoms are split in contiguous chunks with approximately the same number of pairs
+  const unsigned npairs = nl.size();
+  vector<unsigned> chunk_start(nt+1, size);
+  for (unsigned ichunk=0; ichunk<nt; ++ichunk) {
+    chunk_start[ichunk] = std::lower_bound(nl_start.begin(), nl_start.end(), (ichunk*(unsigned long)npairs)/nt) - nl_start.begin();
+  }
   #pragma omp parallel num_threads(nt)
   {
     vector<Vector> deriv_omp(size);
     #pragma omp for reduction(+:bias)
-    for (unsigned i=0; i<size; ++i) {
-      const Vector posi = getPosition(i);
-      double fedensity = 0.0;
-      Vector deriv_i;
-      const double vdw_volume_i   = parameter[i][0];
-      const double delta_g_free_i = parameter[i][1];
-      const double inv_lambda_i   = parameter[i][2];
-      const double vdw_radius_i   = parameter[i][3];
+    for (unsigned ichunk=0; ichunk<nt; ++ichunk) {
+      for (unsigned i=chunk_start[ichunk]; i<chunk_start[ichunk+1]; ++i) {
+        const Vector posi = getPosition(i);
+        double fedensity = 0.0;
+        Vector deriv_i;
+        const double vdw_volume_i   = parameter[i][0];
+        const double delta_g_free_i = parameter[i][1];
+        const double inv_lambda_i   = parameter[i][2];
+        const double vdw_radius_i   = parameter[i][3];
 
-      // The pairwise interactions are unsymmetric, but we can get away with calculating the distance only once
-      for (unsigned i_nl=0; i_nl<nl[i].size(); ++i_nl) {
-        const unsigned j = nl[i][i_nl];
-        const double vdw_volume_j   = parameter[j][0];
-        const double delta_g_free_j = parameter[j][1];
-        const double inv_lambda_j   = parameter[j][2];
-        const double vdw_radius_j   = parameter[j][3];
+        // The pairwise interactions are unsymmetric, but we can get away with calculating the distance only once
+        for (unsigned i_nl=nl_start[i]; i_nl<nl_start[i+1]; ++i_nl) {
+          const unsigned j = nl[i_nl];
+          const double vdw_volume_j   = parameter[j][0];
+          const double delta_g_free_j = parameter[j][1];
+          const double inv_lambda_j   = parameter[j][2];
+          const double vdw_radius_j   = parameter[j][3];
 
-        const Vector dist     = delta(posi, getPosition(j));
-        const double rij      = dist.modulo();
-        const double inv_rij  = 1.0 / rij;
-        const double inv_rij2 = inv_rij * inv_rij;
-        const double fact_ij  = inv_rij2 * delta_g_free_i * vdw_volume_j * INV_PI_SQRT_PI* inv_lambda_i;
-        const double fact_ji  = inv_rij2 * delta_g_free_j * vdw_volume_i * INV_PI_SQRT_PI* inv_lambda_j;
-        double deriv = 0.;
+          const Vector dist     = delta(posi, getPosition(j));
+          const double rij      = dist.modulo();
+          const double inv_rij  = 1.0 / rij;
+          const double inv_rij2 = inv_rij * inv_rij;
+          const double fact_ij  = inv_rij2 * delta_g_free_i * vdw_volume_j * INV_PI_SQRT_PI* inv_lambda_i;
+          const double fact_ji  = inv_rij2 * delta_g_free_j * vdw_volume_i * INV_PI_SQRT_PI* inv_lambda_j;
+          double deriv = 0.;
 
-        // in this case we can calculate a single exponential
-        if(!nlexpo[i][i_nl]) {
-          // i-j interaction
-          if(inv_rij > 0.25*inv_lambda_i)
-          {
-            const double inv_lambda2_i = inv_lambda_i * inv_lambda_i;
-            const double rij_vdwr_diff = rij - vdw_radius_i;
-            const double expo = exp(-inv_lambda2_i * rij_vdwr_diff * rij_vdwr_diff);
-            const double fact = expo * fact_ij;
-            fedensity += fact;
-            deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2_i);
-          }
+          // in this case we can calculate a single exponential
+          if(inv_lambda_i != inv_lambda_j || vdw_radius_i != vdw_radius_j) {
+            // i-j interaction
+            if(inv_rij > 0.25*inv_lambda_i)
+            {
+              const double inv_lambda2_i = inv_lambda_i * inv_lambda_i;
+              const double rij_vdwr_diff = rij - vdw_radius_i;
+              const double expo = exp(-inv_lambda2_i * rij_vdwr_diff * rij_vdwr_diff);
+              const double fact = expo * fact_ij;
+              fedensity += fact;
+              deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2_i);
+            }
 
-          // j-i interaction
-          if(inv_rij > 0.25*inv_lambda_j)
-          {
-            const double inv_lambda2_j = inv_lambda_j * inv_lambda_j;
-            const double rij_vdwr_diff = rij - vdw_radius_j;
-            const double expo = exp(-inv_lambda2_j * rij_vdwr_diff * rij_vdwr_diff);
-            const double fact = expo * fact_ji;
-            fedensity += fact;
-            deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2_j);
-          }
-        } else {
-          // i-j interaction
-          if(inv_rij > 0.25*inv_lambda_i)
-          {
-            const double inv_lambda2 = inv_lambda_i * inv_lambda_i;
-            const double rij_vdwr_diff = rij - vdw_radius_i;
-            const double expo = exp(-inv_lambda2 * rij_vdwr_diff * rij_vdwr_diff);
-            const double fact = expo*(fact_ij + fact_ji);
-            fedensity += fact;
-            deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2);
+            // j-i interaction
+            if(inv_rij > 0.25*inv_lambda_j)
+            {
+              const double inv_lambda2_j = inv_lambda_j * inv_lambda_j;
+              const double rij_vdwr_diff = rij - vdw_radius_j;
+              const double expo = exp(-inv_lambda2_j * rij_vdwr_diff * rij_vdwr_diff);
+              const double fact = expo * fact_ji;
+              fedensity += fact;
+              deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2_j);
+            }
+          } else {
+            // i-j interaction
+            if(inv_rij > 0.25*inv_lambda_i)
+            {
+              const double inv_lambda2 = inv_lambda_i * inv_lambda_i;
+              const double rij_vdwr_diff = rij - vdw_radius_i;
+              const double expo = exp(-inv_lambda2 * rij_vdwr_diff * rij_vdwr_diff);
+              const double fact = expo*(fact_ij + fact_ji);
+              fedensity += fact;
+              deriv     += inv_rij * fact * (inv_rij + rij_vdwr_diff * inv_lambda2);
+            }
           }
-        }
 
-        const Vector dd = deriv*dist;
-        deriv_i      += dd;
-        deriv_omp[j] -= dd;
+          const Vector dd = deriv*dist;
+          deriv_i      += dd;
+          deriv_omp[j] -= dd;
+        }
+        deriv_omp[i] += deriv_i;
+        bias += - 0.5 * fedensity;
       }
-      deriv_omp[i] += deriv_i;
-      bias += - 0.5 * fedensity;
     }
     #pragma omp critical
     for(unsigned i=0; i<size; i++) {
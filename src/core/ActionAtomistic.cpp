@@ -32,6 +32,8 @@
 #include "Atoms.h"
 #include "tools/Pbc.h"
 #include "tools/PDB.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -47,6 +49,10 @@ ActionAtomistic::ActionAtomistic(const ActionOptions&ao):
   lockRequestAtoms(false),
   donotretrieve(false),
   donotforce(false),
+  requestsVirtualAtoms(false),
+  indexesAreDistinct(true),
+  indexesAreContiguous(false),
+  massAndChargeVersion(0),
   atoms(plumed.getAtoms())
 {
   atoms.add(this);
@@ -69,14 +75,27 @@ void ActionAtomistic::requestAtoms(const vector<AtomNumber> & a) {
   int n=atoms.positions.size();
   clearDependencies();
   unique.clear();
+  requestsVirtualAtoms=false;
   for(unsigned i=0; i<indexes.size(); i++) {
     if(indexes[i].index()>=n) error("atom out of range");
-    if(atoms.isVirtualAtom(indexes[i])) addDependency(atoms.getVirtualAtomsAction(indexes[i]));
+    if(atoms.isVirtualAtom(indexes[i])) {
+      addDependency(atoms.getVirtualAtomsAction(indexes[i]));
+      requestsVirtualAtoms=true;
+    }
 // only real atoms are requested to lower level Atoms class
     else unique.insert(indexes[i]);
   }
+// when atoms are all different forces can be scattered in parallel,
+// and when they are also consecutive they can be retrieved as a single block
+  indexesAreDistinct=(!requestsVirtualAtoms && unique.size()==indexes.size());
+  indexesAreContiguous=(indexesAreDistinct && indexes.size()>0);
+  for(unsigned i=1; i<indexes.size() && indexesAreContiguous; i++) {
+    if(indexes[i].index()!=indexes[0].index()+i) indexesAreContiguous=false;
+  }
+// force masses and charges to be retrieved at next step
+  massAndChargeVersion=atoms.massAndChargeVersion-1;
   updateUniqueLocal();
-  atoms.unique.clear();
+  atoms.requestsVersion++;
 }
 
 Vector ActionAtomistic::pbcDistance(const Vector &v1,const Vector &v2)const {
@@ -219,9 +238,20 @@ void ActionAtomistic::retrieveAtoms() {
   const vector<Vector> & p(atoms.positions);
   const vector<double> & c(atoms.charges);
   const vector<double> & m(atoms.masses);
-  for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
-  for(unsigned j=0; j<indexes.size(); j++) charges[j]=c[indexes[j].index()];
-  for(unsigned j=0; j<indexes.size(); j++) masses[j]=m[indexes[j].index()];
+  const unsigned first=(indexesAreContiguous?indexes[0].index():0);
+  if(indexesAreContiguous) std::copy(p.begin()+first,p.begin()+first+indexes.size(),positions.begin());
+  else for(unsigned j=0; j<indexes.size(); j++) positions[j]=p[indexes[j].index()];
+// masses and charges of real atoms only change when Atoms shares them again,
+// whereas those of virtual atoms are recomputed at every step
+  if(!requestsVirtualAtoms && massAndChargeVersion==atoms.massAndChargeVersion) return;
+  if(indexesAreContiguous) {
+    std::copy(c.begin()+first,c.begin()+first+indexes.size(),charges.begin());
+    std::copy(m.begin()+first,m.begin()+first+indexes.size(),masses.begin());
+  } else {
+    for(unsigned j=0; j<indexes.size(); j++) charges[j]=c[indexes[j].index()];
+    for(unsigned j=0; j<indexes.size(); j++) masses[j]=m[indexes[j].index()];
+  }
+  massAndChargeVersion=atoms.massAndChargeVersion;
 }
 
 void ActionAtomistic::setForcesOnAtoms( const std::vector<double>& forcesToApply, unsigned ind ) {
@@ -247,7 +277,19 @@ void ActionAtomistic::applyForces() {
   if(donotforce) return;
   vector<Vector>   & f(atoms.forces);
   Tensor           & v(atoms.virial);
-  for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+  if(indexesAreContiguous) {
+    Vector* fp=&f[indexes[0].index()];
+    const unsigned nt=OpenMP::getGoodNumThreads(forces);
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned j=0; j<indexes.size(); j++) fp[j]+=forces[j];
+  } else if(indexesAreDistinct) {
+// no atom appears twice, so that there are no races among threads
+    const unsigned nt=OpenMP::getGoodNumThreads(forces);
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+  } else {
+    for(unsigned j=0; j<indexes.size(); j++) f[indexes[j].index()]+=forces[j];
+  }
   v+=virial;
   atoms.forceOnEnergy+=forceOnEnergy;
 }
@@ -271,6 +313,8 @@ void ActionAtomistic::readAtomsFromPDB( const PDB& pdb ) {
   }
   for(unsigned j=0; j<indexes.size(); j++) charges[j]=pdb.getBeta()[indexes[j].index()];
   for(unsigned j=0; j<indexes.size(); j++) masses[j]=pdb.getOccupancy()[indexes[j].index()];
+// masses and charges do not come from Atoms anymore
+  massAndChargeVersion=atoms.massAndChargeVersion-1;
 }
 
 void ActionAtomistic::makeWhole() {
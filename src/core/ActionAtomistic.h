@@ -63,6 +63,15 @@ class ActionAtomistic :
   bool                  donotretrieve;
   bool                  donotforce;
 
+/// true if some of the requested atoms are virtual atoms
+  bool                  requestsVirtualAtoms;
+/// true if the requested atoms are real atoms and are all different
+  bool                  indexesAreDistinct;
+/// true if the requested atoms are different real atoms with consecutive indexes
+  bool                  indexesAreContiguous;
+/// value of Atoms::massAndChargeVersion when masses and charges were last retrieved
+  unsigned              massAndChargeVersion;
+
 protected:
   Atoms&                atoms;
 
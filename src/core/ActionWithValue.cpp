@@ -113,20 +113,20 @@ void ActionWithValue::addValueWithDerivatives() {
 }
 
 void ActionWithValue::setNotPeriodic() {
-  plumed_massert(values.size()==1,"The number of components is not equal to one");
+  plumed_massert(!values.empty(),"The default value has not been added");
   plumed_massert(values[0]->name==getLabel(), "The value you are trying to set is not the default");
   values[0]->min=0; values[0]->max=0;
   values[0]->setupPeriodicity();
 }
 
 void ActionWithValue::setPeriodic( const std::string& min, const std::string& max ) {
-  plumed_massert(values.size()==1,"The number of components is not equal to one");
+  plumed_massert(!values.empty(),"The default value has not been added");
   plumed_massert(values[0]->name==getLabel(), "The value you are trying to set is not the default");
   values[0]->setDomain( min, max );
 }
 
 Value* ActionWithValue::getPntrToValue() {
-  plumed_dbg_massert(values.size()==1,"The number of components is not equal to one");
+  plumed_dbg_massert(!values.empty(),"The default value has not been added");
   plumed_dbg_massert(values[0]->name==getLabel(), "The value you are trying to retrieve is not the default");
   return values[0].get();
 }
@@ -139,8 +139,8 @@ void ActionWithValue::addComponent( const std::string& name ) {
             "registerKeywords as described in the developer docs.");
   }
   std::string thename; thename=getLabel() + "." + name;
+// components without derivatives can follow the default value
   for(unsigned i=0; i<values.size(); ++i) {
-    plumed_massert(values[i]->name!=getLabel(),"Cannot mix single values with components");
     plumed_massert(values[i]->name!=thename&&name!="bias","Since PLUMED 2.3 the component 'bias' is automatically added to all biases by the general constructor!\n"
                    "Remove the line addComponent(\"bias\") from your bias.");
     plumed_massert(values[i]->name!=thename,"there is already a value with this name");
@@ -168,7 +168,6 @@ void ActionWithValue::addComponentWithDerivatives( const std::string& name ) {
 }
 
 int ActionWithValue::getComponent( const std::string& name ) const {
-  plumed_massert( !exists( getLabel() ), "You should not be calling this routine if you are using a value");
   std::string thename; thename=getLabel() + "." + name;
   for(unsigned i=0; i<values.size(); ++i) {
     if (values[i]->name==thename) return i;
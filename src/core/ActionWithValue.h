@@ -61,6 +61,9 @@ your PLMD::Action calculates multiple quantities then these quantities are refer
 label.component syntax.  We refer to these <b> multiple quantities </b> the <b> components </b>
 of the PLMD::Action.  Perhaps unsurprisingly, when you manipulate the <b> components </b> of an
 PLMD::Action you should use <b> the routines with the word component in the name. </b>
+Components without derivatives (e.g. diagnostic counters) can also be added with
+PLMD::ActionWithValue::addComponent() after the <b> value </b>, which then remains
+accessible using the label of the PLMD::Action.
 */
 
 class ActionWithValue :
@@ -187,8 +190,7 @@ double ActionWithValue::getOutputQuantity( const std::string& name ) const {
 
 inline
 void ActionWithValue::setValue(const double& d) {
-  plumed_massert(values.size()==1, "cannot use setValue in multi-component actions");
-  plumed_massert(values[0]->name==getLabel(), "The value you are trying to set is not the default");
+  plumed_massert(!values.empty() && values[0]->name==getLabel(), "cannot use setValue in multi-component actions");
   values[0]->set(d);
 }
 
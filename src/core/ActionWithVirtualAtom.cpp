@@ -21,6 +21,7 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "ActionWithVirtualAtom.h"
 #include "Atoms.h"
+#include "tools/OpenMP.h"
 
 using namespace std;
 
@@ -35,6 +36,7 @@ void ActionWithVirtualAtom::registerKeywords(Keywords& keys) {
 ActionWithVirtualAtom::ActionWithVirtualAtom(const ActionOptions&ao):
   Action(ao),
   ActionAtomistic(ao),
+  scalarDerivatives(false),
   boxDerivatives(3)
 {
   index=atoms.addVirtualAtom(this);
@@ -47,7 +49,15 @@ ActionWithVirtualAtom::~ActionWithVirtualAtom() {
 
 void ActionWithVirtualAtom::apply() {
   Vector & f(atoms.forces[index.index()]);
-  for(unsigned i=0; i<getNumberOfAtoms(); i++) modifyForces()[i]=matmul(derivatives[i],f);
+  std::vector<Vector> & forces(modifyForces());
+  const unsigned n=getNumberOfAtoms();
+  if(scalarDerivatives) {
+    #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(forces))
+    for(unsigned i=0; i<n; i++) forces[i]=weightDerivatives[i]*f;
+  } else {
+    #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(forces))
+    for(unsigned i=0; i<n; i++) forces[i]=matmul(derivatives[i],f);
+  }
   Tensor & v(modifyVirial());
   for(unsigned i=0; i<3; i++) v+=boxDerivatives[i]*f[i];
   f.zero(); // after propagating the force to the atoms used to compute the vatom, we reset this to zero
@@ -60,19 +70,29 @@ void ActionWithVirtualAtom::requestAtoms(const std::vector<AtomNumber> & a) {
   derivatives.resize(a.size());
 }
 
+void ActionWithVirtualAtom::setAtomsDerivatives(const std::vector<double> &w) {
+  weightDerivatives=w;
+  scalarDerivatives=true;
+// the tensors allocated by requestAtoms are not needed anymore
+  if(!derivatives.empty()) std::vector<Tensor>().swap(derivatives);
+}
+
 void ActionWithVirtualAtom::setGradients() {
   gradients.clear();
   for(unsigned i=0; i<getNumberOfAtoms(); i++) {
     AtomNumber an=getAbsoluteIndex(i);
+    Tensor d;
+    if(scalarDerivatives) d=weightDerivatives[i]*Tensor::identity();
+    else d=derivatives[i];
     // this case if the atom is a virtual one
     if(atoms.isVirtualAtom(an)) {
       const ActionWithVirtualAtom* a=atoms.getVirtualAtomsAction(an);
       for(const auto & p : a->gradients) {
-        gradients[p.first]+=matmul(derivatives[i],p.second);
+        gradients[p.first]+=matmul(d,p.second);
       }
       // this case if the atom is a normal one
     } else {
-      gradients[an]+=derivatives[i];
+      gradients[an]+=d;
     }
   }
 }
@@ -95,7 +115,9 @@ void ActionWithVirtualAtom::setBoxDerivativesNoPbc() {
 // and derivatives. Notice that this only works only when Pbc have not been used to compute
 // derivatives.
         for(unsigned l=0; l<getNumberOfAtoms(); l++) {
-          bd[k][i][j]-=getPosition(l)[i]*derivatives[l][j][k];
+          if(scalarDerivatives) {
+            if(j==k) bd[k][i][j]-=getPosition(l)[i]*weightDerivatives[l];
+          } else bd[k][i][j]-=getPosition(l)[i]*derivatives[l][j][k];
         }
       }
   setBoxDerivatives(bd);
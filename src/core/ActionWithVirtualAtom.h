@@ -42,6 +42,10 @@ class ActionWithVirtualAtom:
 {
   AtomNumber index;
   std::vector<Tensor> derivatives;
+/// Derivatives stored as scalar weights (see setAtomsDerivatives(const std::vector<double>&))
+  std::vector<double> weightDerivatives;
+/// True if the derivatives are stored as scalar weights
+  bool scalarDerivatives;
   std::vector<Tensor> boxDerivatives;
   std::map<AtomNumber,Tensor> gradients;
   void apply();
@@ -56,6 +60,11 @@ protected:
   void requestAtoms(const std::vector<AtomNumber> & a);
 /// Set the derivatives of virtual atom coordinate wrt atoms on which it dependes
   void setAtomsDerivatives(const std::vector<Tensor> &d);
+/// Set the derivatives of virtual atom coordinate wrt atoms on which it dependes
+/// when each of them is a multiple of the identity (e.g. vatom::COM and vatom::Center).
+/// Element i is the weight of atom i, that is the derivative is w[i] times the identity.
+/// This avoids storing and multiplying a full tensor per atom.
+  void setAtomsDerivatives(const std::vector<double> &w);
 /// Set the box derivatives.
 /// This should be a vector of size 3. First index corresponds
 /// to the components of the virtual atom.
@@ -107,6 +116,7 @@ void ActionWithVirtualAtom::setCharge(double c) {
 inline
 void ActionWithVirtualAtom::setAtomsDerivatives(const std::vector<Tensor> &d) {
   derivatives=d;
+  scalarDerivatives=false;
 }
 
 inline
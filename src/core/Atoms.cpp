@@ -28,11 +28,58 @@
 #include <iostream>
 #include <string>
 #include <cmath>
+#include <cstring>
 
 using namespace std;
 
 namespace PLMD {
 
+/// Atoms exchanged with domain decomposition are packed in a single message,
+/// containing for each atom the distance from the index of the previous atom
+/// (with a variable number of bytes) followed by its positions, and possibly
+/// mass and charge, stored as doubles or floats.
+/// This is the largest number of bytes used for each atom.
+static const unsigned maxBytesPerAtom=5+5*sizeof(double);
+
+static char* packIndex(char*p,unsigned delta) {
+  while(delta>=128) {
+    *p++=char((delta&127)|128);
+    delta>>=7;
+  }
+  *p++=char(delta);
+  return p;
+}
+
+static const char* unpackIndex(const char*p,unsigned&delta) {
+  delta=0;
+  for(unsigned shift=0;; shift+=7) {
+    const unsigned char b=*p++;
+    delta|=unsigned(b&127)<<shift;
+    if(!(b&128)) return p;
+  }
+}
+
+template<typename T>
+static char* packReals(char*p,const double*d,int n) {
+  for(int i=0; i<n; i++) {
+    const T t=T(d[i]);
+    std::memcpy(p,&t,sizeof(T));
+    p+=sizeof(T);
+  }
+  return p;
+}
+
+template<typename T>
+static const char* unpackReals(const char*p,double*d,int n) {
+  for(int i=0; i<n; i++) {
+    T t;
+    std::memcpy(&t,p,sizeof(T));
+    d[i]=t;
+    p+=sizeof(T);
+  }
+  return p;
+}
+
 /// We assume that charges and masses are constant along the simulation
 /// Set this to false if you want to revert to the original (expensive) behavior
 static const bool shareMassAndChargeOnlyAtFirstStep=true;
@@ -41,6 +88,8 @@ class PlumedMain;
 
 Atoms::Atoms(PlumedMain&plumed):
   natoms(0),
+  requestsVersion(0),
+  uniqueVersion(0),
   md_energy(0.0),
   energy(0.0),
   dataCanBeSet(false),
@@ -53,6 +102,8 @@ Atoms::Atoms(PlumedMain&plumed):
   forcesHaveBeenSet(0),
   virialHasBeenSet(false),
   massAndChargeOK(false),
+  massAndChargeShared(false),
+  massAndChargeVersion(0),
   shuffledAtoms(0),
   mdatoms(MDAtomsBase::create(sizeof(double))),
   plumed(plumed),
@@ -139,48 +190,78 @@ void Atoms::share() {
 // At first step I scatter all the atoms so as to store their mass and charge
 // Notice that this works with the assumption that charges and masses are
 // not changing during the simulation!
-  if(!massAndChargeOK && shareMassAndChargeOnlyAtFirstStep) {
+// In targeted mode, masses and charges are instead shared together with the positions
+// only at the steps in which some atom is requested for the first time
+  massAndChargeShared=!massAndChargeOK;
+  const bool targeted=(dd.targeted && shuffledAtoms>0);
+  if(!massAndChargeOK && shareMassAndChargeOnlyAtFirstStep && !targeted) {
     shareAll();
     return;
   }
 
-  if(!(int(gatindex.size())==natoms && shuffledAtoms==0)) {
-    for(unsigned i=0; i<actions.size(); i++) {
-      if(actions[i]->isActive()) {
-        if(!actions[i]->getUnique().empty()) {
-          atomsNeeded=true;
-          // unique are the local atoms
-          unique.insert(actions[i]->getUniqueLocal().begin(),actions[i]->getUniqueLocal().end());
-        }
-      }
+  bool changed=(uniqueVersion!=requestsVersion);
+  if(uniqueNeeded.size()!=actions.size()) {
+    uniqueNeeded.assign(actions.size(),false);
+    changed=true;
+  }
+  for(unsigned i=0; i<actions.size(); i++) {
+    const bool needed=(actions[i]->isActive() && !actions[i]->getUnique().empty());
+    if(needed) atomsNeeded=true;
+    if(needed!=uniqueNeeded[i]) {
+      uniqueNeeded[i]=needed;
+      changed=true;
     }
-  } else {
+  }
+
+// the list is only rebuilt when the active actions or their requests have changed.
+// when all atoms are retrieved it is not used
+  if(changed && !(int(gatindex.size())==natoms && shuffledAtoms==0)) {
+    unique.clear();
     for(unsigned i=0; i<actions.size(); i++) {
-      if(actions[i]->isActive()) {
-        if(!actions[i]->getUnique().empty()) {
-          atomsNeeded=true;
-        }
+      // unique are the local atoms
+      if(uniqueNeeded[i]) unique.insert(unique.end(),actions[i]->getUniqueLocal().begin(),actions[i]->getUniqueLocal().end());
+    }
+    std::sort(unique.begin(),unique.end());
+    unique.erase(std::unique(unique.begin(),unique.end()),unique.end());
+    uniqueVersion=requestsVersion;
+    if(targeted) {
+// the check is done on the global list of requested atoms, which is the same on all
+// the processes, so that they all agree on what is sent without communicating
+      std::vector<AtomNumber> requested;
+      for(unsigned i=0; i<actions.size(); i++) {
+        if(uniqueNeeded[i]) requested.insert(requested.end(),actions[i]->getUnique().begin(),actions[i]->getUnique().end());
       }
+      std::sort(requested.begin(),requested.end());
+      requested.erase(std::unique(requested.begin(),requested.end()),requested.end());
+      if(int(massAndChargeReceived.size())!=natoms) massAndChargeReceived.assign(natoms,false);
+      for(const auto & p : requested) if(!massAndChargeReceived[p.index()]) {
+          massAndChargeShared=true;
+          break;
+        }
+      dd.reserveReceived(requested.size());
     }
-
   }
 
   share(unique);
 }
 
 void Atoms::shareAll() {
+  massAndChargeShared=!massAndChargeOK;
+  if(dd) dd.reserveReceived(natoms);
   unique.clear();
   // keep in unique only those atoms that are local
   if(dd && shuffledAtoms>0) {
-    for(int i=0; i<natoms; i++) if(dd.g2l[i]>=0) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) if(dd.g2l[i]>=0) unique.push_back(AtomNumber::index(i));
   } else {
-    for(int i=0; i<natoms; i++) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) unique.push_back(AtomNumber::index(i));
   }
+  // unique does not reflect the requests anymore
+  requestsVersion++;
   atomsNeeded=true;
   share(unique);
 }
 
-void Atoms::share(const std::set<AtomNumber>& unique) {
+void Atoms::share(const std::vector<AtomNumber>& unique) {
   plumed_assert( positionsHaveBeenSet==3 && massesHaveBeenSet );
 
   virial.zero();
@@ -213,10 +294,14 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
 
 // how many double per atom should be scattered:
   int ndata=3;
-  if(!massAndChargeOK) {
+  if(massAndChargeShared) {
     ndata=5;
-    masses.assign(masses.size(),NAN);
-    charges.assign(charges.size(),NAN);
+    massAndChargeVersion++;
+// in targeted mode, masses and charges received at previous steps are kept
+    if(!massAndChargeOK) {
+      masses.assign(masses.size(),NAN);
+      charges.assign(charges.size(),NAN);
+    }
     mdatoms->getCharges(gatindex,charges);
     mdatoms->getMasses(gatindex,masses);
   }
@@ -224,51 +309,61 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
   if(dd && shuffledAtoms>0) {
     if(dd.async) {
       for(unsigned i=0; i<dd.mpi_request_positions.size(); i++) dd.mpi_request_positions[i].wait();
-      for(unsigned i=0; i<dd.mpi_request_index.size(); i++)     dd.mpi_request_index[i].wait();
     }
-    int count=0;
-    for(const auto & p : unique) {
-      dd.indexToBeSent[count]=p.index();
-      dd.positionsToBeSent[ndata*count+0]=positions[p.index()][0];
-      dd.positionsToBeSent[ndata*count+1]=positions[p.index()][1];
-      dd.positionsToBeSent[ndata*count+2]=positions[p.index()][2];
-      if(!massAndChargeOK) {
-        dd.positionsToBeSent[ndata*count+3]=masses[p.index()];
-        dd.positionsToBeSent[ndata*count+4]=charges[p.index()];
+// unique is sorted, so that only the (small) increments of the index are sent
+    char* p=&dd.bufferToBeSent[0];
+    unsigned last=0;
+    double data[5];
+    for(const auto & a : unique) {
+      const unsigned index=a.index();
+      plumed_dbg_assert(index>=last);
+      p=packIndex(p,index-last);
+      last=index;
+      data[0]=positions[index][0];
+      data[1]=positions[index][1];
+      data[2]=positions[index][2];
+      if(massAndChargeShared) {
+        data[3]=masses[index];
+        data[4]=charges[index];
       }
-      count++;
+      if(dd.floatShare) p=packReals<float>(p,data,ndata);
+      else p=packReals<double>(p,data,ndata);
     }
+    const int count=p-&dd.bufferToBeSent[0];
     if(dd.async) {
       asyncSent=true;
       dd.mpi_request_positions.resize(dd.Get_size());
-      dd.mpi_request_index.resize(dd.Get_size());
-      for(int i=0; i<dd.Get_size(); i++) {
-        dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,666);
-        dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],ndata*count,i,667);
-      }
+      for(int i=0; i<dd.Get_size(); i++) dd.mpi_request_positions[i]=dd.Isend(&dd.bufferToBeSent[0],count,i,667);
     } else {
       const int n=(dd.Get_size());
       vector<int> counts(n);
       vector<int> displ(n);
-      vector<int> counts5(n);
-      vector<int> displ5(n);
       dd.Allgather(count,counts);
       displ[0]=0;
       for(int i=1; i<n; ++i) displ[i]=displ[i-1]+counts[i-1];
-      for(int i=0; i<n; ++i) counts5[i]=counts[i]*ndata;
-      for(int i=0; i<n; ++i) displ5[i]=displ[i]*ndata;
-      dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&counts[0],&displ[0]);
-      dd.Allgatherv(&dd.positionsToBeSent[0],ndata*count,&dd.positionsToBeReceived[0],&counts5[0],&displ5[0]);
-      int tot=displ[n-1]+counts[n-1];
-      for(int i=0; i<tot; i++) {
-        positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
-        positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
-        positions[dd.indexToBeReceived[i]][2]=dd.positionsToBeReceived[ndata*i+2];
-        if(!massAndChargeOK) {
-          masses[dd.indexToBeReceived[i]]      =dd.positionsToBeReceived[ndata*i+3];
-          charges[dd.indexToBeReceived[i]]     =dd.positionsToBeReceived[ndata*i+4];
-        }
-      }
+      dd.Allgatherv(&dd.bufferToBeSent[0],count,&dd.bufferToBeReceived[0],&counts[0],&displ[0]);
+      for(int i=0; i<n; ++i) unpack(&dd.bufferToBeReceived[displ[i]],counts[i],ndata);
+    }
+  }
+}
+
+void Atoms::unpack(const char*p,int count,int ndata) {
+  const char* end=p+count;
+  unsigned index=0;
+  double data[5];
+  while(p<end) {
+    unsigned delta;
+    p=unpackIndex(p,delta);
+    index+=delta;
+    if(dd.floatShare) p=unpackReals<float>(p,data,ndata);
+    else p=unpackReals<double>(p,data,ndata);
+    positions[index][0]=data[0];
+    positions[index][1]=data[1];
+    positions[index][2]=data[2];
+    if(massAndChargeShared) {
+      masses[index]=data[3];
+      charges[index]=data[4];
+      if(!massAndChargeReceived.empty()) massAndChargeReceived[index]=true;
     }
   }
 }
@@ -277,7 +372,7 @@ void Atoms::wait() {
   dataCanBeSet=false; // Everything should be set by this stage
 // How many double per atom should be scattered
   int ndata=3;
-  if(!massAndChargeOK)ndata=5;
+  if(massAndChargeShared)ndata=5;
 
   if(dd) {
     dd.Bcast(box,0);
@@ -290,21 +385,10 @@ void Atoms::wait() {
 // receive toBeReceived
     if(asyncSent) {
       Communicator::Status status;
-      int count=0;
+// messages are unpacked as soon as they are received, so that the buffer is reused
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
-        int c=status.Get_count<int>();
-        dd.Recv(&dd.positionsToBeReceived[ndata*count],dd.positionsToBeReceived.size()-ndata*count,i,667);
-        count+=c;
-      }
-      for(int i=0; i<count; i++) {
-        positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
-        positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
-        positions[dd.indexToBeReceived[i]][2]=dd.positionsToBeReceived[ndata*i+2];
-        if(!massAndChargeOK) {
-          masses[dd.indexToBeReceived[i]]      =dd.positionsToBeReceived[ndata*i+3];
-          charges[dd.indexToBeReceived[i]]     =dd.positionsToBeReceived[ndata*i+4];
-        }
+        dd.Recv(&dd.bufferToBeReceived[0],dd.bufferToBeReceived.size(),i,667,status);
+        unpack(&dd.bufferToBeReceived[0],status.Get_count<char>(),ndata);
       }
       asyncSent=false;
     }
@@ -337,6 +421,7 @@ void Atoms::setNatoms(int n) {
   forces.resize(n);
   masses.resize(n);
   charges.resize(n);
+  massAndChargeVersion++;
   gatindex.resize(n);
   for(unsigned i=0; i<gatindex.size(); i++) gatindex[i]=i;
 }
@@ -344,12 +429,14 @@ void Atoms::setNatoms(int n) {
 
 void Atoms::add(ActionAtomistic*a) {
   actions.push_back(a);
+  requestsVersion++;
 }
 
 void Atoms::remove(ActionAtomistic*a) {
   auto f=find(actions.begin(),actions.end(),a);
   plumed_massert(f!=actions.end(),"cannot remove an action registered to atoms");
   actions.erase(f);
+  requestsVersion++;
 }
 
 
@@ -363,6 +450,18 @@ void Atoms::DomainDecomposition::enable(Communicator& c) {
     else if(s=="no") async=false;
     else plumed_merror("PLUMED_ASYNC_SHARE variable is set to " + s + "; should be yes or no");
   }
+  if(std::getenv("PLUMED_TARGETED_SHARE")) {
+    std::string s(std::getenv("PLUMED_TARGETED_SHARE"));
+    if(s=="yes") targeted=true;
+    else if(s=="no") targeted=false;
+    else plumed_merror("PLUMED_TARGETED_SHARE variable is set to " + s + "; should be yes or no");
+  }
+}
+
+void Atoms::DomainDecomposition::reserveReceived(unsigned n) {
+// at least one element, see setAtomsNlocal()
+  if(n==0) n++;
+  if(bufferToBeReceived.size()<n*maxBytesPerAtom) bufferToBeReceived.resize(n*maxBytesPerAtom,0);
 }
 
 void Atoms::setAtomsNlocal(int n) {
@@ -370,14 +469,13 @@ void Atoms::setAtomsNlocal(int n) {
   if(dd) {
     dd.g2l.resize(natoms,-1);
 // Since these vectors are sent with MPI by using e.g.
-// &dd.positionsToBeSent[0]
+// &dd.bufferToBeSent[0]
 // we make sure they are non-zero-sized so as to
 // avoid errors when doing boundary check
     if(n==0) n++;
-    dd.positionsToBeSent.resize(n*5,0.0);
-    dd.positionsToBeReceived.resize(natoms*5,0.0);
-    dd.indexToBeSent.resize(n,0);
-    dd.indexToBeReceived.resize(natoms,0);
+    dd.bufferToBeSent.resize(n*maxBytesPerAtom,0);
+// in targeted mode the receive buffers are enlarged in share() when needed
+    if(!dd.targeted) dd.reserveReceived(natoms);
   };
 }
 
@@ -407,7 +505,7 @@ void Atoms::setAtomsGatindex(int*g,bool fortran) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  requestsVersion++;
 }
 
 void Atoms::setAtomsContiguous(int start) {
@@ -420,7 +518,7 @@ void Atoms::setAtomsContiguous(int start) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  requestsVersion++;
 }
 
 void Atoms::setRealPrecision(int p) {
@@ -440,6 +538,12 @@ void Atoms::double2MD(const double&d,void*m)const {
 
 void Atoms::updateUnits() {
   mdatoms->setUnits(units,MDUnits);
+// by default positions, masses and charges are exchanged as floats only when the MD code uses
+// single precision and they are not converted to different units, since in this case they are
+// exchanged exactly as they were passed by the MD code
+  if(dd && !dd.floatShareEnforced) dd.floatShare=(mdatoms->getRealPrecision()==sizeof(float)
+        && units.getLength()==MDUnits.getLength() && units.getMass()==MDUnits.getMass()
+        && units.getCharge()==MDUnits.getCharge());
 }
 
 void Atoms::setTimeStep(void*p) {
@@ -483,6 +587,13 @@ void Atoms::init() {
 // Default: set domain decomposition to NO-decomposition, waiting for
 // further instruction
   if(dd) {
+    if(std::getenv("PLUMED_FLOAT_SHARE")) {
+      std::string s(std::getenv("PLUMED_FLOAT_SHARE"));
+      if(s=="yes") dd.floatShare=true;
+      else if(s=="no") dd.floatShare=false;
+      else plumed_merror("PLUMED_FLOAT_SHARE variable is set to " + s + "; should be yes or no");
+      dd.floatShareEnforced=true;
+    }
     setAtomsNlocal(natoms);
     setAtomsContiguous(0);
   }
@@ -497,6 +608,7 @@ void Atoms::resizeVectors(unsigned n) {
   forces.resize(n);
   masses.resize(n);
   charges.resize(n);
+  massAndChargeVersion++;
 }
 
 AtomNumber Atoms::addVirtualAtom(ActionWithVirtualAtom*a) {
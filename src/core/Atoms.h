@@ -49,8 +49,16 @@ class Atoms
   friend class ActionAtomistic;
   friend class ActionWithVirtualAtom;
   int natoms;
-  std::set<AtomNumber> unique;
+/// sorted list of the (local) atoms requested by the active actions
+  std::vector<AtomNumber> unique;
   std::vector<unsigned> uniq_index;
+/// incremented every time the atoms requested by the actions or their
+/// ownership change, so that unique is only rebuilt when needed
+  unsigned requestsVersion;
+/// value of requestsVersion when unique was last built
+  unsigned uniqueVersion;
+/// actions that needed atoms when unique was last built
+  std::vector<bool> uniqueNeeded;
   std::vector<Vector> positions;
   std::vector<Vector> forces;
   std::vector<double> masses;
@@ -75,6 +83,13 @@ class Atoms
   unsigned forcesHaveBeenSet;
   bool virialHasBeenSet;
   bool massAndChargeOK;
+/// true if masses and charges are sent together with positions at this step
+  bool massAndChargeShared;
+/// in targeted mode, the atoms whose masses and charges have already been received
+  std::vector<bool> massAndChargeReceived;
+/// incremented every time masses and charges of real atoms are modified,
+/// so that actions only retrieve them again when needed
+  unsigned massAndChargeVersion;
   unsigned shuffledAtoms;
 
   std::map<std::string,std::vector<AtomNumber> > groups;
@@ -115,26 +130,35 @@ class Atoms
   public:
     bool on;
     bool async;
+/// if true, masses and charges are only shared for the requested atoms
+/// and the receive buffers are only as large as the list of requested atoms
+    bool targeted;
+/// if true, positions, masses and charges are exchanged in single precision
+    bool floatShare;
+/// true if floatShare was set with PLUMED_FLOAT_SHARE
+    bool floatShareEnforced;
     std::vector<int>    g2l;
 
     std::vector<Communicator::Request> mpi_request_positions;
-    std::vector<Communicator::Request> mpi_request_index;
 
-    std::vector<double> positionsToBeSent;
-    std::vector<double> positionsToBeReceived;
-    std::vector<int>    indexToBeSent;
-    std::vector<int>    indexToBeReceived;
+/// packed messages with indexes and positions of the atoms, see Atoms::unpack()
+    std::vector<char>   bufferToBeSent;
+    std::vector<char>   bufferToBeReceived;
     operator bool() const {return on;}
     DomainDecomposition():
-      on(false), async(false)
+      on(false), async(false), targeted(false), floatShare(false), floatShareEnforced(false)
     {}
     void enable(Communicator& c);
+/// make sure that the receive buffers can host n atoms
+    void reserveReceived(unsigned n);
   };
 
   DomainDecomposition dd;
   long int ddStep;  //last step in which dd happened
 
-  void share(const std::set<AtomNumber>&);
+  void share(const std::vector<AtomNumber>&);
+/// unpack a message of count bytes received from another process
+  void unpack(const char*,int count,int ndata);
 
 public:
 
@@ -24,6 +24,7 @@
 #include "ActionPilot.h"
 #include "ActionRegister.h"
 #include "ActionSet.h"
+#include "ActionWithArguments.h"
 #include "ActionWithValue.h"
 #include "ActionWithVirtualAtom.h"
 #include "Atoms.h"
@@ -41,8 +42,10 @@
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
 #include "DataFetchingObject.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <set>
 #include <unordered_map>
 
@@ -78,7 +81,9 @@ PlumedMain::PlumedMain():
   stopFlag(NULL),
   stopNow(false),
   novirial(false),
-  detailedTimers(false)
+  detailedTimers(false),
+  concurrentActions(1),
+  threadsPerAction(1)
 {
   log.link(comm);
   log.setLinePrefix("PLUMED: ");
@@ -100,11 +105,202 @@ PlumedMain::~PlumedMain() {
 #define CHECK_NOTNULL(val,word) plumed_massert(val,"NULL pointer received in cmd(\"" + word + "\")");
 
 
+/// Frequent commands are those executed by runFrequentCommand().
+/// They are listed explicitly, so that the order of the cases in cmd() does not matter
+static bool isFrequentCommand(int iword) {
+  static const std::set<int> frequent= {
+    cmd_setBox, cmd_setPositions, cmd_setMasses, cmd_setCharges,
+    cmd_setPositionsX, cmd_setPositionsY, cmd_setPositionsZ,
+    cmd_setVirial, cmd_setEnergy,
+    cmd_setForces, cmd_setForcesX, cmd_setForcesY, cmd_setForcesZ,
+    cmd_calc, cmd_prepareDependencies, cmd_shareData, cmd_prepareCalc,
+    cmd_performCalc, cmd_performCalcNoUpdate, cmd_update,
+    cmd_setStep, cmd_setStepLong, cmd_setStepData
+  };
+  return frequent.count(iword)>0;
+}
+
+void PlumedMain::runFrequentCommand(int iword,const std::string & word,void*val) {
+// these commands are called at every step by the MD code.
+// only the commands doing some calculation are timed, the others just store a pointer
+  switch(iword) {
+  case cmd_setBox:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    atoms.setBox(val);
+    break;
+  case cmd_setPositions:
+    CHECK_INIT(initialized,word);
+    atoms.setPositions(val);
+    break;
+  case cmd_setMasses:
+    CHECK_INIT(initialized,word);
+    atoms.setMasses(val);
+    break;
+  case cmd_setCharges:
+    CHECK_INIT(initialized,word);
+    atoms.setCharges(val);
+    break;
+  case cmd_setPositionsX:
+    CHECK_INIT(initialized,word);
+    atoms.setPositions(val,0);
+    break;
+  case cmd_setPositionsY:
+    CHECK_INIT(initialized,word);
+    atoms.setPositions(val,1);
+    break;
+  case cmd_setPositionsZ:
+    CHECK_INIT(initialized,word);
+    atoms.setPositions(val,2);
+    break;
+  case cmd_setVirial:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    atoms.setVirial(val);
+    break;
+  case cmd_setEnergy:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    atoms.setEnergy(val);
+    break;
+  case cmd_setForces:
+    CHECK_INIT(initialized,word);
+    atoms.setForces(val);
+    break;
+  case cmd_setForcesX:
+    CHECK_INIT(initialized,word);
+    atoms.setForces(val,0);
+    break;
+  case cmd_setForcesY:
+    CHECK_INIT(initialized,word);
+    atoms.setForces(val,1);
+    break;
+  case cmd_setForcesZ:
+    CHECK_INIT(initialized,word);
+    atoms.setForces(val,2);
+    break;
+  case cmd_calc:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    calc();
+    stopwatch.pause();
+    break;
+  case cmd_prepareDependencies:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    prepareDependencies();
+    stopwatch.pause();
+    break;
+  case cmd_shareData:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    shareData();
+    stopwatch.pause();
+    break;
+  case cmd_prepareCalc:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    prepareCalc();
+    stopwatch.pause();
+    break;
+  case cmd_performCalc:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    performCalc();
+    stopwatch.pause();
+    break;
+  case cmd_performCalcNoUpdate:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    performCalcNoUpdate();
+    stopwatch.pause();
+    break;
+  case cmd_update:
+    CHECK_INIT(initialized,word);
+    stopwatch.start();
+    update();
+    stopwatch.pause();
+    break;
+  case cmd_setStep:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    step=(*static_cast<int*>(val));
+    atoms.startStep();
+    break;
+  case cmd_setStepLong:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    step=(*static_cast<long int*>(val));
+    atoms.startStep();
+    break;
+  case cmd_setStepData:
+    CHECK_INIT(initialized,word);
+    CHECK_NOTNULL(val,word);
+    {
+      void** data=static_cast<void**>(val);
+      CHECK_NOTNULL(data[0],word);
+      step=(*static_cast<long int*>(data[0]));
+      atoms.startStep();
+// per-atom arrays are registered also when NULL on processes without local atoms,
+// as the MD code would do with the individual commands
+      const bool nolocal=atoms.getGatindex().empty();
+      if(data[1]) atoms.setBox(data[1]);
+      if(data[2] || nolocal) atoms.setPositions(data[2]);
+      if(data[3] || nolocal) atoms.setMasses(data[3]);
+      if(data[4] || nolocal) atoms.setCharges(data[4]);
+      if(data[5] || nolocal) atoms.setForces(data[5]);
+      if(data[6]) atoms.setVirial(data[6]);
+      if(data[7]) atoms.setEnergy(data[7]);
+    }
+    break;
+  default:
+    plumed_merror("cannot interpret cmd(\"" + word + "\"). check plumed developers manual to see the available commands.");
+    break;
+  }
+}
+
+PlumedMain::CommandHandle PlumedMain::getCommandHandle(const std::string & word)const {
+  const std::vector<std::string> words=Tools::getWords(word);
+  int iword=-1;
+  if(words.size()==1) {
+    const auto it=plumedMainWordMap().find(words[0]);
+    if(it!=plumedMainWordMap().end()) iword=it->second;
+  }
+  plumed_massert(isFrequentCommand(iword),"cannot get a handle for cmd(\"" + word + "\"). check plumed developers manual to see the commands that can be resolved.");
+  return CommandHandle(iword,words[0]);
+}
+
+void PlumedMain::cmd(const CommandHandle & handle,void*val) {
+  try {
+    plumed_massert(handle.word>=0,"cmd() called with a command handle which was not obtained with getCommandHandle()");
+    runFrequentCommand(handle.word,handle.name,val);
+  } catch (Exception &e) {
+    logException(e);
+    throw;
+  }
+}
+
+void PlumedMain::logException(const Exception &e) {
+  if(log.isOpen()) {
+    log<<"\n\n################################################################################\n\n";
+    log<<e.what();
+    log<<"\n\n################################################################################\n\n";
+    log.flush();
+  }
+}
+
 void PlumedMain::cmd(const std::string & word,void*val) {
 
   try {
 
-    stopwatch.start();
+// frequent commands are made of a single word, which is looked up without splitting
+    if(word.find_first_of(" \t\n")==std::string::npos) {
+      const auto it=plumedMainWordMap().find(word);
+      if(it!=plumedMainWordMap().end() && isFrequentCommand(it->second)) {
+        runFrequentCommand(it->second,word,val);
+        return;
+      }
+    }
 
     std::vector<std::string> words=Tools::getWords(word);
     unsigned nw=words.size();
@@ -115,103 +311,12 @@ void PlumedMain::cmd(const std::string & word,void*val) {
       double d;
       const auto it=plumedMainWordMap().find(words[0]);
       if(it!=plumedMainWordMap().end()) iword=it->second;
+      if(isFrequentCommand(iword)) {
+        runFrequentCommand(iword,word,val);
+        return;
+      }
+      stopwatch.start();
       switch(iword) {
-      case cmd_setBox:
-        CHECK_INIT(initialized,word);
-        CHECK_NOTNULL(val,word);
-        atoms.setBox(val);
-        break;
-      case cmd_setPositions:
-        CHECK_INIT(initialized,word);
-        atoms.setPositions(val);
-        break;
-      case cmd_setMasses:
-        CHECK_INIT(initialized,word);
-        atoms.setMasses(val);
-        break;
-      case cmd_setCharges:
-        CHECK_INIT(initialized,word);
-        atoms.setCharges(val);
-        break;
-      case cmd_setPositionsX:
-        CHECK_INIT(initialized,word);
-        atoms.setPositions(val,0);
-        break;
-      case cmd_setPositionsY:
-        CHECK_INIT(initialized,word);
-        atoms.setPositions(val,1);
-        break;
-      case cmd_setPositionsZ:
-        CHECK_INIT(initialized,word);
-        atoms.setPositions(val,2);
-        break;
-      case cmd_setVirial:
-        CHECK_INIT(initialized,word);
-        CHECK_NOTNULL(val,word);
-        atoms.setVirial(val);
-        break;
-      case cmd_setEnergy:
-        CHECK_INIT(initialized,word);
-        CHECK_NOTNULL(val,word);
-        atoms.setEnergy(val);
-        break;
-      case cmd_setForces:
-        CHECK_INIT(initialized,word);
-        atoms.setForces(val);
-        break;
-      case cmd_setForcesX:
-        CHECK_INIT(initialized,word);
-        atoms.setForces(val,0);
-        break;
-      case cmd_setForcesY:
-        CHECK_INIT(initialized,word);
-        atoms.setForces(val,1);
-        break;
-      case cmd_setForcesZ:
-        CHECK_INIT(initialized,word);
-        atoms.setForces(val,2);
-        break;
-      case cmd_calc:
-        CHECK_INIT(initialized,word);
-        calc();
-        break;
-      case cmd_prepareDependencies:
-        CHECK_INIT(initialized,word);
-        prepareDependencies();
-        break;
-      case cmd_shareData:
-        CHECK_INIT(initialized,word);
-        shareData();
-        break;
-      case cmd_prepareCalc:
-        CHECK_INIT(initialized,word);
-        prepareCalc();
-        break;
-      case cmd_performCalc:
-        CHECK_INIT(initialized,word);
-        performCalc();
-        break;
-      case cmd_performCalcNoUpdate:
-        CHECK_INIT(initialized,word);
-        performCalcNoUpdate();
-        break;
-      case cmd_update:
-        CHECK_INIT(initialized,word);
-        update();
-        break;
-      case cmd_setStep:
-        CHECK_INIT(initialized,word);
-        CHECK_NOTNULL(val,word);
-        step=(*static_cast<int*>(val));
-        atoms.startStep();
-        break;
-      case cmd_setStepLong:
-        CHECK_INIT(initialized,word);
-        CHECK_NOTNULL(val,word);
-        step=(*static_cast<long int*>(val));
-        atoms.startStep();
-        break;
-      // words used less frequently:
       case cmd_setAtomsNlocal:
         CHECK_INIT(initialized,word);
         CHECK_NOTNULL(val,word);
@@ -278,7 +383,7 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         break;
       case cmd_getApiVersion:
         CHECK_NOTNULL(val,word);
-        *(static_cast<int*>(val))=6;
+        *(static_cast<int*>(val))=7;
         break;
       // commands which can be used only before initialization:
       case cmd_init:
@@ -463,16 +568,11 @@ void PlumedMain::cmd(const std::string & word,void*val) {
         plumed_merror("cannot interpret cmd(\"" + word + "\"). check plumed developers manual to see the available commands.");
         break;
       }
+      stopwatch.pause();
     }
-    stopwatch.pause();
 
   } catch (Exception &e) {
-    if(log.isOpen()) {
-      log<<"\n\n################################################################################\n\n";
-      log<<e.what();
-      log<<"\n\n################################################################################\n\n";
-      log.flush();
-    }
+    logException(e);
     throw;
   }
 }
@@ -660,12 +760,33 @@ void PlumedMain::waitData() {
   stopwatch.stop("3 Waiting for data");
 }
 
+void PlumedMain::calculateAction(Action*p) {
+  ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
+  ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
+  {
+    if(av) av->clearInputForces();
+    if(av) av->clearDerivatives();
+  }
+  {
+    if(aa) aa->clearOutputForces();
+    if(aa) if(aa->isActive()) aa->retrieveAtoms();
+  }
+  if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
+  else p->calculate();
+  if(av)av->setGradientsIfNeeded();
+  ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
+  if(avv)avv->setGradientsIfNeeded();
+}
+
 void PlumedMain::justCalculate() {
   if(!active)return;
   stopwatch.start("4 Calculating (forward loop)");
   bias=0.0;
   work=0.0;
 
+  const bool concurrent=doConcurrentActions();
+  if(concurrent) justCalculateConcurrently();
+
   int iaction=0;
 // calculate the active actions in order (assuming *backward* dependence)
   for(const auto & pp : actionSet) {
@@ -677,24 +798,11 @@ void PlumedMain::justCalculate() {
         actionNumberLabel="4A "+actionNumberLabel+" "+p->getLabel();
         stopwatch.start(actionNumberLabel);
       }
-      ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
-      ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
-      {
-        if(av) av->clearInputForces();
-        if(av) av->clearDerivatives();
-      }
-      {
-        if(aa) aa->clearOutputForces();
-        if(aa) if(aa->isActive()) aa->retrieveAtoms();
-      }
-      if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
-      else p->calculate();
+      if(!concurrent) calculateAction(p);
       // This retrieves components called bias
+      ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
       if(av) bias+=av->getOutputQuantity("bias");
       if(av) work+=av->getOutputQuantity("work");
-      if(av)av->setGradientsIfNeeded();
-      ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
-      if(avv)avv->setGradientsIfNeeded();
       if(detailedTimers) stopwatch.stop(actionNumberLabel);
     }
     iaction++;
@@ -711,26 +819,30 @@ void PlumedMain::backwardPropagate() {
   if(!active)return;
   int iaction=0;
   stopwatch.start("5 Applying (backward loop)");
+  if(doConcurrentActions()) {
+    backwardPropagateConcurrently();
+  } else {
 // apply them in reverse order
-  for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
-    const auto & p(pp->get());
-    if(p->isActive()) {
-
-      std::string actionNumberLabel;
-      if(detailedTimers) {
-        Tools::convert(iaction,actionNumberLabel);
-        actionNumberLabel="5A "+actionNumberLabel+" "+p->getLabel();
-        stopwatch.start(actionNumberLabel);
-      }
+    for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
+      const auto & p(pp->get());
+      if(p->isActive()) {
+
+        std::string actionNumberLabel;
+        if(detailedTimers) {
+          Tools::convert(iaction,actionNumberLabel);
+          actionNumberLabel="5A "+actionNumberLabel+" "+p->getLabel();
+          stopwatch.start(actionNumberLabel);
+        }
 
-      p->apply();
-      ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
+        p->apply();
+        ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
 // still ActionAtomistic has a special treatment, since they may need to add forces on atoms
-      if(a) a->applyForces();
+        if(a) a->applyForces();
 
-      if(detailedTimers) stopwatch.stop(actionNumberLabel);
+        if(detailedTimers) stopwatch.stop(actionNumberLabel);
+      }
+      iaction++;
     }
-    iaction++;
   }
 
 // this is updating the MD copy of the forces
@@ -740,6 +852,126 @@ void PlumedMain::backwardPropagate() {
   stopwatch.stop("5 Applying (backward loop)");
 }
 
+bool PlumedMain::doConcurrentActions()const {
+// per-action timers are not thread safe
+  return concurrentActions>1 && !detailedTimers;
+}
+
+unsigned PlumedMain::getThreadsForAction(const Action*p)const {
+  auto it=actionThreads.find(p->getLabel());
+  if(it!=actionThreads.end()) return it->second;
+  return threadsPerAction;
+}
+
+/// Actions that can be calculated at the same time as other actions.
+/// Actions that have no value might modify the global positions (e.g. WHOLEMOLECULES)
+/// or write output (e.g. PRINT), and so do atomistic actions controlled by a stride
+/// (e.g. FIT_TO_TEMPLATE). All of them are calculated alone.
+static bool canCalculateConcurrently(Action*p) {
+  if(p->checkNumericalDerivatives()) return false;
+  if(dynamic_cast<ActionPilot*>(p) && dynamic_cast<ActionAtomistic*>(p)) return false;
+  return dynamic_cast<ActionWithValue*>(p)!=NULL;
+}
+
+/// Actions whose apply() only writes forces stored in the action itself.
+/// Actions with arguments add forces on the values of other actions, which
+/// could be shared with other actions in the same level.
+static bool canApplyConcurrently(Action*p) {
+  if(!dynamic_cast<ActionAtomistic*>(p) || dynamic_cast<ActionWithArguments*>(p)) return false;
+  for(const auto & d : p->getDependencies()) if(!dynamic_cast<ActionWithVirtualAtom*>(d)) return false;
+  return true;
+}
+
+void PlumedMain::buildActionLevels() {
+  if(actionIndex.size()!=actionSet.size()) {
+    actionIndex.clear();
+    for(unsigned i=0; i<actionSet.size(); ++i) actionIndex[actionSet[i].get()]=i;
+    for(const auto & a : actionThreads) if(!actionSet.selectWithLabel<Action*>(a.first))
+        plumed_merror("CONCURRENT_ACTIONS: there is no action with label " + a.first + " (see ACTION_THREADS)");
+  }
+  for(auto & l : actionLevels) l.clear();
+  std::vector<int> level(actionSet.size(),-1);
+  int first=0,last=-1;
+  for(unsigned i=0; i<actionSet.size(); ++i) {
+    Action* p(actionSet[i].get());
+    if(!p->isActive()) continue;
+    int l=first;
+    if(!canCalculateConcurrently(p)) {
+// alone in its level, after all the previous actions and before all the following ones
+      l=last+1;
+      first=l+1;
+    } else {
+      for(const auto & d : p->getDependencies()) {
+        int ld=level[actionIndex[d]];
+        if(ld>=l) l=ld+1;
+      }
+    }
+    level[i]=l;
+    if(l>last) last=l;
+    if(actionLevels.size()<=unsigned(l)) actionLevels.resize(l+1);
+    actionLevels[l].push_back(p);
+  }
+  actionLevels.resize(last+1);
+}
+
+void PlumedMain::justCalculateConcurrently() {
+  buildActionLevels();
+  for(const auto & level : actionLevels) {
+    if(level.size()==1) {
+      calculateAction(level[0]);
+      continue;
+    }
+    std::exception_ptr eptr;
+    unsigned nt=concurrentActions;
+    if(nt>level.size()) nt=level.size();
+    #pragma omp parallel for num_threads(nt) schedule(dynamic,1)
+    for(unsigned i=0; i<level.size(); ++i) {
+      OpenMP::setThreadBudget(getThreadsForAction(level[i]));
+      try {
+        calculateAction(level[i]);
+      } catch(...) {
+        #pragma omp critical
+        if(!eptr) eptr=std::current_exception();
+      }
+      OpenMP::setThreadBudget(0);
+    }
+    if(eptr) std::rethrow_exception(eptr);
+  }
+}
+
+void PlumedMain::backwardPropagateConcurrently() {
+  std::vector<Action*> concurrent;
+  for(auto pl=actionLevels.rbegin(); pl!=actionLevels.rend(); ++pl) {
+    const auto & level(*pl);
+    concurrent.clear();
+    if(level.size()>1) for(const auto & p : level) if(canApplyConcurrently(p)) concurrent.push_back(p);
+    if(concurrent.size()>1) {
+      std::exception_ptr eptr;
+      unsigned nt=concurrentActions;
+      if(nt>concurrent.size()) nt=concurrent.size();
+      #pragma omp parallel for num_threads(nt) schedule(dynamic,1)
+      for(unsigned i=0; i<concurrent.size(); ++i) {
+        OpenMP::setThreadBudget(getThreadsForAction(concurrent[i]));
+        try {
+          concurrent[i]->apply();
+        } catch(...) {
+          #pragma omp critical
+          if(!eptr) eptr=std::current_exception();
+        }
+        OpenMP::setThreadBudget(0);
+      }
+      if(eptr) std::rethrow_exception(eptr);
+    } else concurrent.clear();
+// forces are added to the global arrays one action at a time, in reverse order
+    for(auto pp=level.rbegin(); pp!=level.rend(); ++pp) {
+      Action* p(*pp);
+      if(std::find(concurrent.begin(),concurrent.end(),p)==concurrent.end()) p->apply();
+      ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
+      if(a) a->applyForces();
+    }
+  }
+}
+
 void PlumedMain::update() {
   if(!active)return;
 
@@ -52,6 +52,7 @@ namespace PLMD {
 
 
 
+class Action;
 class ActionAtomistic;
 class ActionPilot;
 class Log;
@@ -64,6 +65,7 @@ class Citations;
 class ExchangePatterns;
 class FileBase;
 class DataFetchingObject;
+class Exception;
 
 /**
 Main plumed object.
@@ -185,6 +187,28 @@ private:
 /// Store information used in class \ref generic::UpdateIf
   std::stack<bool> updateFlags;
 
+/// Active actions grouped in levels that can be calculated concurrently
+  std::vector<std::vector<Action*>> actionLevels;
+/// Position of each action in the action set, used to build actionLevels
+  std::map<const Action*,unsigned> actionIndex;
+/// Calculate a single action (forward loop)
+  void calculateAction(Action*);
+/// Group the active actions in levels such that all the actions in a level only depend
+/// on actions in previous levels
+  void buildActionLevels();
+/// Forward loop with independent actions calculated concurrently
+  void justCalculateConcurrently();
+/// Backward loop with independent actions applied concurrently
+  void backwardPropagateConcurrently();
+/// Number of openMP threads that an action can use when calculated concurrently
+  unsigned getThreadsForAction(const Action*)const;
+/// Check if actions should be calculated concurrently
+  bool doConcurrentActions()const;
+/// Execute one of the commands that are called at every step by the MD code
+  void runFrequentCommand(int iword,const std::string&word,void*val);
+/// Write an exception raised in cmd() on the log
+  void logException(const Exception&);
+
 public:
 /// Flag to switch off virial calculation (for debug and MD codes with no barostat)
   bool novirial;
@@ -192,6 +216,16 @@ public:
 /// Flag to switch on detailed timers
   bool detailedTimers;
 
+/// Maximum number of actions that are calculated at the same time (see \ref CONCURRENT_ACTIONS).
+/// Actions are calculated one at a time if this is smaller than two.
+  unsigned concurrentActions;
+
+/// Number of openMP threads that each action can use when calculated concurrently
+  unsigned threadsPerAction;
+
+/// Number of openMP threads for specific actions (by label) when calculated concurrently
+  std::map<std::string,unsigned> actionThreads;
+
 /// Generic map string -> double
 /// intended to pass information across Actions
   std::map<std::string,double> passMap;
@@ -225,6 +259,26 @@ public:
    Notice that this interface should always keep retro-compatibility
   */
   void cmd(const std::string&key,void*val=NULL);
+/// Opaque handle to a command, obtained with getCommandHandle().
+  class CommandHandle {
+    friend class PlumedMain;
+    int word;
+    std::string name;
+    CommandHandle(int word,const std::string&name): word(word), name(name) {}
+  public:
+    CommandHandle(): word(-1) {}
+  };
+  /**
+   Resolve a command once, so that it can be later executed with cmd(const CommandHandle&,void*)
+   without any string processing.
+   Only the commands that are called at every step by the MD code (from setBox to setStepData
+   in the developer manual) can be resolved.
+   Notice that this is only available to C++ codes using directly this class, and
+   not through the Plumed.h interface.
+  */
+  CommandHandle getCommandHandle(const std::string&key)const;
+/// Execute a command resolved with getCommandHandle().
+  void cmd(const CommandHandle&handle,void*val=NULL);
   ~PlumedMain();
   /**
     Read an input file.
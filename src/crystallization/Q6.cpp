@@ -185,8 +185,6 @@ Q6::Q6(const ActionOptions& ao ):
   Action(ao),
   Steinhardt(ao)
 {
-  setAngularMomentum(6);
-
   normaliz.resize( 7 );
   normaliz[0] = sqrt( ( 13.0*720.0 ) / (4.0*pi*720.0) );
   normaliz[1] = -sqrt( ( 13.0*120.0 ) / (4.0*pi*5040) );
@@ -201,6 +199,8 @@ Q6::Q6(const ActionOptions& ao ):
   coeff_poly[2]=6.5625; coeff_poly[3]=0.0;
   coeff_poly[4]=-19.6875; coeff_poly[5]=0.0;
   coeff_poly[6]=14.4375;
+
+  setAngularMomentum(6);
 }
 
 }
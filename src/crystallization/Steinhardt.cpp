@@ -21,7 +21,6 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Steinhardt.h"
 #include "core/PlumedMain.h"
-#include <complex>
 
 namespace PLMD {
 namespace crystallization {
@@ -66,17 +65,29 @@ Steinhardt::Steinhardt( const ActionOptions& ao ):
 }
 
 void Steinhardt::setAngularMomentum( const unsigned& ang ) {
+  plumed_assert( coeff_poly.size()==ang+1 && normaliz.size()==ang+1 );
   tmom=ang; setVectorDimensionality( 2*(2*ang + 1) );
+  // The polynomial for m is normaliz[m] times the m-th derivative of sum_i coeff_poly[i] x^i
+  poly_ass_coeff.resize( tmom+1 );
+  for(unsigned m=0; m<=tmom; ++m) {
+    poly_ass_coeff[m].resize( tmom+1-m );
+    for(unsigned i=m; i<=tmom; ++i) {
+      double fact=1.0;
+      for(unsigned j=i-m+1; j<=i; ++j) fact=fact*j;
+      poly_ass_coeff[m][i-m]=normaliz[m]*coeff_poly[i]*fact;
+    }
+  }
 }
 
 void Steinhardt::calculateVector( multicolvar::AtomValuePack& myatoms ) const {
-  double dfunc, dpoly_ass, md, tq6, itq6, real_z, imag_z;
-  Vector dz, myrealvec, myimagvec, real_dz, imag_dz;
-  // The square root of -1
-  std::complex<double> ii( 0.0, 1.0 ), dp_x, dp_y, dp_z;
-
-  unsigned ncomp=2*tmom+1;
-  double sw, poly_ass, dlen; std::complex<double> powered;
+  double dfunc, dpoly_ass, tq6, itq6, real_z, imag_z;
+  Vector dz, real_dz, imag_dz, real_dcom, imag_dcom, myrealvec, myimagvec;
+
+  unsigned ncomp=2*tmom+1, nvals=2*ncomp;
+  // The contributions of each neighbour to all the components are accumulated together.
+  // The derivatives wrt x of all the components are stored first, then those wrt y and z
+  std::vector<double> vals( nvals, 0.0 ), ders( 3*nvals, 0.0 );
+  double sw, poly_ass, dlen;
   for(unsigned i=1; i<myatoms.getNumberOfAtoms(); ++i) {
     Vector& distance=myatoms.getPosition(i);  // getSeparation( myatoms.getPosition(0), myatoms.getPosition(i) );
     double d2;
@@ -88,64 +99,58 @@ void Steinhardt::calculateVector( multicolvar::AtomValuePack& myatoms ) const {
       dlen = sqrt(d2);
       sw = switchingFunction.calculate( dlen, dfunc );
       accumulateSymmetryFunction( -1, i, sw, (+dfunc)*distance, (-dfunc)*Tensor( distance,distance ), myatoms );
-      double dlen3 = d2*dlen;
+      double rlen = 1.0 / dlen, rlen3 = rlen / d2;
       // Do stuff for m=0
-      poly_ass=deriv_poly( 0, distance[2]/dlen, dpoly_ass );
+      poly_ass=evaluatePoly( 0, distance[2]*rlen, dpoly_ass );
       // Derivatives of z/r wrt x, y, z
-      dz = -( distance[2] / dlen3 )*distance; dz[2] += (1.0 / dlen);
+      dz = -( distance[2]*rlen3 )*distance; dz[2] += rlen;
       // Derivative wrt to the vector connecting the two atoms
       myrealvec = (+sw)*dpoly_ass*dz + poly_ass*(+dfunc)*distance;
-      // Accumulate the derivatives
-      accumulateSymmetryFunction( 2 + tmom, i, sw*poly_ass, myrealvec, Tensor( -myrealvec,distance ), myatoms );
+      vals[tmom] = sw*poly_ass;
+      for(unsigned c=0; c<3; ++c) ders[c*nvals+tmom] = myrealvec[c];
 
-      // The complex number of which we have to take powers
-      std::complex<double> com1( distance[0]/dlen,distance[1]/dlen );
-      powered = std::complex<double>(1.0,0.0);
+      // Real and imaginary parts of the derivatives of (x+iy)/r wrt x, y, z
+      real_dcom[0] = rlen - distance[0]*distance[0]*rlen3; imag_dcom[0] = -distance[0]*distance[1]*rlen3;
+      real_dcom[1] = -distance[0]*distance[1]*rlen3;       imag_dcom[1] = rlen - distance[1]*distance[1]*rlen3;
+      real_dcom[2] = -distance[0]*distance[2]*rlen3;       imag_dcom[2] = -distance[1]*distance[2]*rlen3;
+      // Real and imaginary parts of (x+iy)/r and of its (m-1)-th power
+      double real_com=distance[0]*rlen, imag_com=distance[1]*rlen, real_pow=1.0, imag_pow=0.0;
 
       // Do stuff for all other m values
       for(unsigned m=1; m<=tmom; ++m) {
         // Calculate Legendre Polynomial
-        poly_ass=deriv_poly( m, distance[2]/dlen, dpoly_ass );
-        // Calculate power of complex number
-        // if(std::abs(com1)>epsilon) powered=pow(com1,m-1);
-        // else if(m==1) powered=std::complex<double>(1.,0);
-        // else powered = std::complex<double>(0.,0.);
-        // Real and imaginary parts of z
-        real_z = real(com1*powered); imag_z = imag(com1*powered );
+        poly_ass=evaluatePoly( m, distance[2]*rlen, dpoly_ass );
+        // Real and imaginary parts of z = ( (x+iy)/r )^m
+        real_z = real_pow*real_com - imag_pow*imag_com;
+        imag_z = real_pow*imag_com + imag_pow*real_com;
 
         // Calculate steinhardt parameter
         tq6=poly_ass*real_z;   // Real part of steinhardt parameter
         itq6=poly_ass*imag_z;  // Imaginary part of steinhardt parameter
 
-        // Derivatives wrt ( x/r + iy )^m
-        md=static_cast<double>(m);
-        dp_x = md*powered*( (1.0/dlen)-(distance[0]*distance[0])/dlen3-ii*(distance[0]*distance[1])/dlen3 );
-        dp_y = md*powered*( ii*(1.0/dlen)-(distance[0]*distance[1])/dlen3-ii*(distance[1]*distance[1])/dlen3 );
-        dp_z = md*powered*( -(distance[0]*distance[2])/dlen3-ii*(distance[1]*distance[2])/dlen3 );
-
-        // Derivatives of real and imaginary parts of above
-        real_dz[0] = real( dp_x ); real_dz[1] = real( dp_y ); real_dz[2] = real( dp_z );
-        imag_dz[0] = imag( dp_x ); imag_dz[1] = imag( dp_y ); imag_dz[2] = imag( dp_z );
+        // Derivatives of real and imaginary parts of z, i.e. m*( (x+iy)/r )^(m-1) times the derivatives of (x+iy)/r
+        double md=static_cast<double>(m);
+        real_dz = md*( real_pow*real_dcom - imag_pow*imag_dcom );
+        imag_dz = md*( real_pow*imag_dcom + imag_pow*real_dcom );
 
         // Complete derivative of steinhardt parameter
         myrealvec = (+sw)*dpoly_ass*real_z*dz + (+dfunc)*distance*tq6 + (+sw)*poly_ass*real_dz;
         myimagvec = (+sw)*dpoly_ass*imag_z*dz + (+dfunc)*distance*itq6 + (+sw)*poly_ass*imag_dz;
-
-        // Real part
-        accumulateSymmetryFunction( 2 + tmom + m, i, sw*tq6, myrealvec, Tensor( -myrealvec,distance ), myatoms );
-        // Imaginary part
-        accumulateSymmetryFunction( 2+ncomp+tmom+m, i, sw*itq6, myimagvec, Tensor( -myimagvec,distance ), myatoms );
-        // Store -m part of vector
-        double pref=pow(-1.0,m);
         // -m part of vector is just +m part multiplied by (-1.0)**m and multiplied by complex
         // conjugate of Legendre polynomial
-        // Real part
-        accumulateSymmetryFunction( 2+tmom-m, i, pref*sw*tq6, pref*myrealvec, pref*Tensor( -myrealvec,distance ), myatoms );
-        // Imaginary part
-        accumulateSymmetryFunction( 2+ncomp+tmom-m, i, -pref*sw*itq6, -pref*myimagvec, pref*Tensor( myimagvec,distance ), myatoms );
+        double pref=(m%2==0 ? 1.0 : -1.0);
+        // Real and imaginary parts for +m and -m
+        vals[tmom+m] = sw*tq6; vals[ncomp+tmom+m] = sw*itq6;
+        vals[tmom-m] = pref*sw*tq6; vals[ncomp+tmom-m] = -pref*sw*itq6;
+        for(unsigned c=0; c<3; ++c) {
+          double* myders=&ders[c*nvals];
+          myders[tmom+m] = myrealvec[c]; myders[ncomp+tmom+m] = myimagvec[c];
+          myders[tmom-m] = pref*myrealvec[c]; myders[ncomp+tmom-m] = -pref*myimagvec[c];
+        }
         // Calculate next power of complex number
-        powered *= com1;
+        real_pow=real_z; imag_pow=imag_z;
       }
+      accumulateSymmetryFunctions( 2, i, distance, vals, ders, myatoms );
     }
   }
 
@@ -154,21 +159,14 @@ void Steinhardt::calculateVector( multicolvar::AtomValuePack& myatoms ) const {
   for(unsigned i=0; i<getNumberOfComponentsInVector(); ++i) myatoms.getUnderlyingMultiValue().quotientRule( 2+i, 2+i );
 }
 
-double Steinhardt::deriv_poly( const unsigned& m, const double& val, double& df ) const {
-  double fact=1.0;
-  for(unsigned j=1; j<=m; ++j) fact=fact*j;
-  double res=coeff_poly[m]*fact;
-
-  double pow=1.0, xi=val, dxi=1.0; df=0.0;
-  for(int i=m+1; i<=tmom; ++i) {
-    double fact=1.0;
-    for(unsigned j=i-m+1; j<=i; ++j) fact=fact*j;
-    res=res+coeff_poly[i]*fact*xi;
-    df = df + pow*coeff_poly[i]*fact*dxi;
-    xi=xi*val; dxi=dxi*val; pow+=1.0;
+double Steinhardt::evaluatePoly( const unsigned& m, const double& val, double& df ) const {
+  const std::vector<double>& coeff=poly_ass_coeff[m];
+  double res=coeff.back(); df=0.0;
+  for(int k=coeff.size()-2; k>=0; --k) {
+    df = df*val + res;
+    res = res*val + coeff[k];
   }
-  df = df*normaliz[m];
-  return normaliz[m]*res;
+  return res;
 }
 
 }
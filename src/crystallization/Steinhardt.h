@@ -34,15 +34,19 @@ private:
   unsigned tmom;
   double rcut,rcut2;
   SwitchingFunction switchingFunction;
+/// Coefficients of the powers of z/r in the normalized associated Legendre polynomials for each m
+  std::vector<std::vector<double> > poly_ass_coeff;
+/// Evaluate the polynomial for m and its derivative with Horner's method
+  double evaluatePoly( const unsigned& m, const double& val, double& df ) const ;
 protected:
   std::vector<double> coeff_poly;
   std::vector<double> normaliz;
+/// Set the angular momentum.  This should be called once coeff_poly and normaliz are set
   void setAngularMomentum( const unsigned& ang );
 public:
   static void registerKeywords( Keywords& keys );
   explicit Steinhardt( const ActionOptions& ao );
   void calculateVector( multicolvar::AtomValuePack& myatoms ) const ;
-  double deriv_poly( const unsigned&, const double&, double& ) const ;
 };
 
 }
@@ -20,7 +20,10 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "PathBase.h"
+#include "vesselbase/Vessel.h"
 #include "tools/SwitchingFunction.h"
+#include "tools/Communicator.h"
+#include <algorithm>
 
 namespace PLMD {
 namespace mapping {
@@ -29,15 +32,29 @@ void PathBase::registerKeywords( Keywords& keys ) {
   Mapping::registerKeywords( keys );
   keys.add("compulsory","LAMBDA","0","the value of the lambda parameter for paths");
   keys.addFlag("NOZPATH",false,"do not calculate the zpath position");
+  keys.add("optional","NEIGH_SIZE","the number of closest frames for which the distance is calculated between neighbour list updates");
+  keys.add("optional","NEIGH_STRIDE","how often the distances from all the frames are calculated to update the neighbour list (in time steps)");
 }
 
 PathBase::PathBase(const ActionOptions& ao):
   Action(ao),
-  Mapping(ao)
+  Mapping(ao),
+  neigh_size(0),
+  neigh_stride(0),
+  allFramesActive(true)
 {
   weightHasDerivatives=true;
   bool noz; parseFlag("NOZPATH",noz);
   parse("LAMBDA",lambda);
+  parse("NEIGH_SIZE",neigh_size);
+  parse("NEIGH_STRIDE",neigh_stride);
+  if( neigh_size>0 || neigh_stride>0 ) {
+    if( neigh_size==0 || neigh_stride==0 ) error("NEIGH_SIZE and NEIGH_STRIDE should be used together");
+    if( neigh_size>getNumberOfReferencePoints() ) neigh_size=getNumberOfReferencePoints();
+    log.printf("  using the %u closest frames, all the frames are considered every %u steps\n",neigh_size,neigh_stride);
+  }
+  // Distances from frames with many atoms are expensive, so that each thread can take a single frame
+  if( getNumberOfAtoms()>0 ) minTasksPerThread=1;
 
   // Create the list of tasks
   for(unsigned i=0; i<getNumberOfReferencePoints(); ++i) addTaskToList( i );
@@ -53,13 +70,51 @@ PathBase::PathBase(const ActionOptions& ao):
   }
 }
 
+void PathBase::readVesselKeywords() {
+  Mapping::readVesselKeywords();
+  // GPATH needs the two closest frames to be active
+  if( neigh_size==1 ) {
+    for(unsigned i=0; i<getNumberOfVessels(); ++i) {
+      if( getPntrToVessel(i)->getName()=="GPATH" ) error("NEIGH_SIZE should be at least two when GPATH is used");
+    }
+  }
+}
+
 double PathBase::getLambda() {
   return lambda;
 }
 
+void PathBase::activateFrames( const bool& all ) {
+  deactivateAllTasks();
+  if( all ) {
+    for(unsigned i=0; i<getFullNumberOfTasks(); ++i) taskFlags[i]=1;
+  } else {
+    for(unsigned i=0; i<neighbours.size(); ++i) taskFlags[neighbours[i]]=1;
+  }
+  lockContributors(); allFramesActive=all;
+}
+
 void PathBase::calculate() {
+  // All the frames are considered at the first step, every neigh_stride steps
+  // and when coordinates are exchanged between replicas
+  bool update=false;
+  if( neigh_size>0 ) {
+    update=( neighbours.empty() || getExchangeStep() || getStep()%neigh_stride==0 );
+    if( update!=allFramesActive ) activateFrames( update );
+    if( update ) framedist.assign( getFullNumberOfTasks(), 0.0 );
+  }
   // Loop over all frames is now performed by ActionWithVessel
   runAllTasks();
+  if( update ) {
+    if( !serialCalculation() ) comm.Sum( framedist );
+    // The transformed distance decreases with the distance when lambda is set
+    std::vector<std::pair<double,unsigned> > ordered( framedist.size() );
+    for(unsigned i=0; i<framedist.size(); ++i) ordered[i]=std::make_pair( lambda>0 ? -framedist[i] : framedist[i], i );
+    std::partial_sort( ordered.begin(), ordered.begin()+neigh_size, ordered.end() );
+    neighbours.resize( neigh_size );
+    for(unsigned i=0; i<neigh_size; ++i) neighbours[i]=ordered[i].second;
+    std::sort( neighbours.begin(), neighbours.end() );
+  }
 }
 
 void PathBase::performTask( const unsigned& task_index, const unsigned& current, MultiValue& myvals ) const {
@@ -68,6 +123,8 @@ void PathBase::performTask( const unsigned& task_index, const unsigned& current,
   finishPackSetup( current, mypack );
   // Calculate the distance from the frame
   double val=calculateDistanceFunction( current, mypack, true );
+  // Store the distance to update the neighbour list
+  if( neigh_size>0 && allFramesActive ) framedist[current]=val;
   // Put the element value in element zero
   myvals.setValue( 0, val ); myvals.setValue( 1, 1.0 );
   return;
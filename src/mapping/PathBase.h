@@ -30,6 +30,21 @@ namespace mapping {
 class PathBase : public Mapping {
 private:
   double lambda;
+/// The number of frames in the neighbour list
+  unsigned neigh_size;
+/// How often the distances from all the frames are calculated
+  unsigned neigh_stride;
+/// Are all the frames currently active
+  bool allFramesActive;
+/// The frames that were closest to the configuration when the list was last updated
+  std::vector<unsigned> neighbours;
+/// The (transformed) distances from all the frames, set by performTask when the list is updated
+  mutable std::vector<double> framedist;
+/// Activate either all the frames or those in the neighbour list
+  void activateFrames( const bool& all );
+protected:
+/// Read the vessels and check that they can be computed with the neighbour list
+  void readVesselKeywords();
 public:
   static void registerKeywords( Keywords& keys );
   explicit PathBase(const ActionOptions&);
@@ -98,11 +98,12 @@ void TrigonometricPathVessel::finish( const std::vector<double>& buffer ) {
   for(unsigned i=0; i<cargs.size(); ++i) cargs[i]=mymap->getArgument(i);
 
   // Determine closest and second closest point to current position
+  if( getNumberOfStoredValues()<2 ) error("at least two frames should be active to calculate the position on the path using trigonometry");
   double lambda=mymap->getLambda();
   std::vector<double> dist( getNumberOfComponents() ), dist2( getNumberOfComponents() );;
   retrieveSequentialValue( 0, false, dist );
   retrieveSequentialValue( 1, false, dist2 );
-  iclose1=getStoreIndex(0); iclose2=getStoreIndex(1);
+  iclose1=mymap->getPositionInFullTaskList(0); iclose2=mymap->getPositionInFullTaskList(1);
   double mindist1=dist[0], mindist2=dist2[0];
   if( lambda>0.0 ) {
     mindist1=-std::log( dist[0] ) / lambda;
@@ -110,7 +111,7 @@ void TrigonometricPathVessel::finish( const std::vector<double>& buffer ) {
   }
   if( mindist2<mindist1 ) {
     double tmp=mindist1; mindist1=mindist2; mindist2=tmp;
-    iclose1=getStoreIndex(1); iclose2=getStoreIndex(0);
+    iclose1=mymap->getPositionInFullTaskList(1); iclose2=mymap->getPositionInFullTaskList(0);
   }
   for(unsigned i=2; i<getNumberOfStoredValues(); ++i) {
     retrieveSequentialValue( i, false, dist );
@@ -118,9 +119,9 @@ void TrigonometricPathVessel::finish( const std::vector<double>& buffer ) {
     if( lambda>0.0 ) ndist=-std::log( dist[0] ) / lambda;
     if( ndist<mindist1 ) {
       mindist2=mindist1; iclose2=iclose1;
-      mindist1=ndist; iclose1=getStoreIndex(i);
+      mindist1=ndist; iclose1=mymap->getPositionInFullTaskList(i);
     } else if( ndist<mindist2 ) {
-      mindist2=ndist; iclose2=getStoreIndex(i);
+      mindist2=ndist; iclose2=mymap->getPositionInFullTaskList(i);
     }
   }
   // And find third closest point
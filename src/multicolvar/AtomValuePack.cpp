@@ -44,7 +44,8 @@ AtomValuePack::AtomValuePack( MultiValue& vals, MultiColvarBase const * mcolv ):
 unsigned AtomValuePack::setupAtomsFromLinkCells( const std::vector<unsigned>& cind, const Vector& cpos, const LinkCells& linkcells ) {
   if( cells_required.size()!=linkcells.getNumberOfCells() ) cells_required.resize( linkcells.getNumberOfCells() );
   // Build the list of cells that we need
-  unsigned ncells_required=0; linkcells.addRequiredCells( linkcells.findMyCell( cpos ), ncells_required, cells_required );
+  unsigned celn[3]; linkcells.findMyCell( cpos, celn );
+  unsigned ncells_required=0; linkcells.addRequiredCells( celn, ncells_required, cells_required );
   // Now build the list of atoms we need
   natoms=cind.size(); for(unsigned i=0; i<natoms; ++i) indices[i]=cind[i];
   linkcells.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
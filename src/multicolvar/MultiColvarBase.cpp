@@ -932,6 +932,28 @@ void MultiColvarBase::accumulateSymmetryFunction( const int& ival, const unsigne
   }
 }
 
+void MultiColvarBase::accumulateSymmetryFunctions( const unsigned& start, const unsigned& iatom, const Vector& distance, const std::vector<double>& val,
+    const std::vector<double>& der, multicolvar::AtomValuePack& myatoms ) const {
+  unsigned n=val.size(); plumed_dbg_assert( usespecies && der.size()==3*n );
+  unsigned katom=myatoms.getIndex(0), jatom=myatoms.getIndex(iatom);
+  // Atoms with weights need the chain rule, which is done one function at a time
+  if( atom_lab[katom].first>0 || atom_lab[jatom].first>0 ) {
+    for(unsigned k=0; k<n; ++k) {
+      Vector myder( der[k], der[n+k], der[2*n+k] );
+      accumulateSymmetryFunction( start+k, iatom, val[k], myder, Tensor( -myder, distance ), myatoms );
+    }
+    return;
+  }
+  MultiValue& myvals=myatoms.getUnderlyingMultiValue();
+  for(unsigned k=0; k<n; ++k) myvals.addValue( start+k, val[k] );
+  if( doNotCalculateDerivatives() ) return ;
+  // Each derivative is activated once for all the functions
+  unsigned nvir=3*getNumberOfAtoms();
+  for(unsigned a=0; a<3; ++a) for(unsigned b=0; b<3; ++b) myvals.addDerivatives( start, n, nvir+3*a+b, -distance[b], &der[a*n] );
+  for(unsigned a=0; a<3; ++a) myvals.addDerivatives( start, n, 3*katom+a, -1.0, &der[a*n] );
+  for(unsigned a=0; a<3; ++a) myvals.addDerivatives( start, n, 3*jatom+a, +1.0, &der[a*n] );
+}
+
 void MultiColvarBase::addAtomDerivatives( const int& ival, const unsigned& iatom, const Vector& der, multicolvar::AtomValuePack& myatoms ) const {
   if( doNotCalculateDerivatives() ) return ;
   unsigned jatom=myatoms.getIndex(iatom);
@@ -115,6 +115,11 @@ protected:
                               MultiValue& myder, AtomValuePack& myatoms ) const ;
 /// This is used to accumulate functions of the coordination sphere.  Ensures weights are taken into account
   void accumulateSymmetryFunction( const int& ival, const unsigned& iatom, const double& val, const Vector& der, const Tensor& vir, multicolvar::AtomValuePack& myatoms ) const ;
+/// Accumulate the contributions of atom iatom to the n=val.size() functions of the coordination sphere starting from start.
+/// der contains the x, y and z derivatives of all the functions one after the other, i.e. der[c*n+k] is component c for function k.
+/// This is equivalent to calling accumulateSymmetryFunction for each function with virial Tensor(-der,distance)
+  void accumulateSymmetryFunctions( const unsigned& start, const unsigned& iatom, const Vector& distance, const std::vector<double>& val,
+                                    const std::vector<double>& der, multicolvar::AtomValuePack& myatoms ) const ;
 /// Set which atoms are to be used to calculate the central atom position
   void setAtomsForCentralAtom( const std::vector<bool>& catom_ind );
 /// Set the value of the cutoff for the link cells
@@ -126,7 +126,7 @@ void VolumeInEnvelope::setupRegions() {
 
 double VolumeInEnvelope::calculateNumberInside( const Vector& cpos, Vector& derivatives, Tensor& vir, std::vector<Vector>& refders ) const {
   unsigned ncells_required=0, natoms=1; std::vector<unsigned> cells_required( mylinks.getNumberOfCells() ), indices( 1 + getNumberOfAtoms() );
-  mylinks.addRequiredCells( mylinks.findMyCell( cpos ), ncells_required, cells_required );
+  unsigned celn[3]; mylinks.findMyCell( cpos, celn ); mylinks.addRequiredCells( celn, ncells_required, cells_required );
   indices[0]=getNumberOfAtoms(); mylinks.retrieveAtomsInCells( ncells_required, cells_required, natoms, indices );
   double value=0; std::vector<double> der(3); Vector tder;
   for(unsigned i=1; i<natoms; ++i) {
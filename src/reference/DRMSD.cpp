@@ -22,6 +22,8 @@
 #include "DRMSD.h"
 #include "MetricRegister.h"
 #include "tools/Pbc.h"
+#include "tools/OpenMP.h"
+#include <algorithm>
 
 namespace PLMD {
 
@@ -58,46 +60,114 @@ void DRMSD::setReferenceAtoms( const std::vector<Vector>& conf, const std::vecto
   setup_targets();
 }
 
+void DRMSD::clearTargets() {
+  target_pairs.clear(); target_distances.clear(); target_atoms.clear();
+}
+
+void DRMSD::addTarget( const unsigned& i, const unsigned& j, const double& distance ) {
+  target_pairs.push_back( std::make_pair(i,j) ); target_distances.push_back( distance );
+}
+
+void DRMSD::finaliseTargets() {
+  // Sort the pairs so that atoms are accessed in order
+  std::vector<unsigned> order( target_pairs.size() );
+  for(unsigned k=0; k<order.size(); ++k) order[k]=k;
+  std::sort( order.begin(), order.end(), [this]( unsigned a, unsigned b ) { return target_pairs[a]<target_pairs[b]; } );
+  std::vector<std::pair<unsigned,unsigned> > sorted_pairs( target_pairs.size() );
+  std::vector<double> sorted_distances( target_distances.size() );
+  for(unsigned k=0; k<order.size(); ++k) {
+    sorted_pairs[k]=target_pairs[order[k]]; sorted_distances[k]=target_distances[order[k]];
+  }
+  target_pairs.swap( sorted_pairs ); target_distances.swap( sorted_distances );
+
+  // And find the atoms that are involved
+  target_atoms.clear();
+  for(unsigned k=0; k<target_pairs.size(); ++k) {
+    target_atoms.push_back( target_pairs[k].first ); target_atoms.push_back( target_pairs[k].second );
+  }
+  std::sort( target_atoms.begin(), target_atoms.end() );
+  target_atoms.erase( std::unique( target_atoms.begin(), target_atoms.end() ), target_atoms.end() );
+}
+
 void DRMSD::setup_targets() {
   plumed_massert( bounds_were_set, "I am missing a call to DRMSD::setBoundsOnDistances");
 
+  clearTargets();
   unsigned natoms = getNumberOfReferencePositions();
   for(unsigned i=0; i<natoms-1; ++i) {
     for(unsigned j=i+1; j<natoms; ++j) {
       double distance = delta( getReferencePosition(i), getReferencePosition(j) ).modulo();
-      if(distance < upper && distance > lower ) {
-        targets[std::make_pair(i,j)] = distance;
-      }
+      if(distance < upper && distance > lower ) addTarget( i, j, distance );
     }
   }
-  if( targets.empty() ) error("drmsd will compare no distances - check upper and lower bounds are sensible");
+  if( target_pairs.empty() ) error("drmsd will compare no distances - check upper and lower bounds are sensible");
+  finaliseTargets();
 }
 
 double DRMSD::calc( const std::vector<Vector>& pos, const Pbc& pbc, ReferenceValuePack& myder, const bool& squared ) const {
-  plumed_dbg_assert(!targets.empty());
+  plumed_dbg_assert(!target_pairs.empty());
 
-  Vector distance;
   myder.clear();
+  const unsigned npairs=target_pairs.size();
+  // Derivatives are accumulated by atom and passed to myder at the end
+  std::vector<Vector> deriv( pos.size() );
+  Tensor virial;
   double drmsd=0.;
-  for(const auto & it : targets) {
 
-    const unsigned i=getAtomIndex( it.first.first );
-    const unsigned j=getAtomIndex( it.first.second );
-
-    if(nopbc) distance=delta( pos[i], pos[j] );
-    else      distance=pbc.distance( pos[i], pos[j] );
+  unsigned nt=OpenMP::getGoodNumThreads( target_distances );
+  // Partial sums are stored per thread and added in thread order below,
+  // so that the result does not depend on which thread finishes first.
+  // The team can be smaller than nt (e.g. when nested in the parallel loop
+  // of PATH), so only the threads that actually ran are merged
+  std::vector<double> omp_drmsd( nt, 0. );
+  std::vector<std::vector<Vector> > omp_deriv( nt>1 ? nt : 0 );
+  std::vector<Tensor> omp_virial( nt );
+  unsigned nteam=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    const unsigned t=OpenMP::getThreadNum();
+    #pragma omp single
+    nteam=OpenMP::getTeamSize();
+    if( nt>1 ) omp_deriv[t].resize( pos.size() );
+
+    #pragma omp for schedule(static) nowait
+    for(unsigned k=0; k<npairs; ++k) {
+
+      const unsigned i=getAtomIndex( target_pairs[k].first );
+      const unsigned j=getAtomIndex( target_pairs[k].second );
+
+      Vector distance;
+      if(nopbc) distance=delta( pos[i], pos[j] );
+      else      distance=pbc.distance( pos[i], pos[j] );
+
+      const double len = distance.modulo();
+      const double diff = len - target_distances[k];
+      const double der = diff / len;
+
+      omp_drmsd[t] += diff * diff;
+      omp_virial[t] -= der * Tensor(distance,distance);
+      if( nt>1 ) {
+        omp_deriv[t][i] -= der * distance;
+        omp_deriv[t][j] += der * distance;
+      } else {
+        deriv[i] -= der * distance;
+        deriv[j] += der * distance;
+      }
+    }
+  }
 
-    const double len = distance.modulo();
-    const double diff = len - it.second;
-    const double der = diff / len;
+  for(unsigned t=0; t<nteam; ++t) {
+    drmsd+=omp_drmsd[t]; virial+=omp_virial[t];
+    if( nt>1 ) for(unsigned i=0; i<deriv.size(); ++i) deriv[i]+=omp_deriv[t][i];
+  }
 
-    drmsd += diff * diff;
-    myder.addAtomDerivatives( i, -der * distance );
-    myder.addAtomDerivatives( j,  der * distance );
-    myder.addBoxDerivatives( - der * Tensor(distance,distance) );
+  for(unsigned k=0; k<target_atoms.size(); ++k) {
+    const unsigned i=getAtomIndex( target_atoms[k] );
+    myder.addAtomDerivatives( i, deriv[i] );
   }
+  myder.addBoxDerivatives( virial );
 
-  const double inpairs = 1./static_cast<double>(targets.size());
+  const double inpairs = 1./static_cast<double>(npairs);
   double idrmsd;
 
   if(squared) {
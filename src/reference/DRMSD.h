@@ -24,7 +24,6 @@
 
 #include <vector>
 #include <string>
-#include <map>
 #include "SingleDomainRMSD.h"
 
 namespace PLMD {
@@ -35,9 +34,19 @@ private:
 protected:
   bool bounds_were_set;
   double lower, upper;
-  std::map< std::pair <unsigned,unsigned>, double> targets;
+/// The pairs of reference atoms that are compared, sorted, and their distances in the reference
+  std::vector<std::pair<unsigned,unsigned> > target_pairs;
+  std::vector<double> target_distances;
+/// The reference atoms that appear in at least one pair
+  std::vector<unsigned> target_atoms;
 /// Read in NOPBC, LOWER_CUTOFF and UPPER_CUTOFF
   void readBounds();
+/// Remove all the pairs
+  void clearTargets();
+/// Add a pair of reference atoms and their distance in the reference
+  void addTarget( const unsigned& i, const unsigned& j, const double& distance );
+/// Sort the pairs and find the atoms involved, must be called after all pairs have been added
+  void finaliseTargets();
 public:
   explicit DRMSD( const ReferenceConfigurationOptions& ro );
 /// This sets upper and lower bounds on distances to be used in DRMSD
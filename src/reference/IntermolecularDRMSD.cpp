@@ -53,16 +53,18 @@ void IntermolecularDRMSD::read( const PDB& pdb ) {
 void IntermolecularDRMSD::setup_targets() {
   plumed_massert( bounds_were_set, "I am missing a call to DRMSD::setBoundsOnDistances");
 
+  clearTargets();
   for(unsigned i=1; i<nblocks; ++i) {
     for(unsigned j=0; j<i; ++j) {
       for(unsigned iatom=blocks[i]; iatom<blocks[i+1]; ++iatom) {
         for(unsigned jatom=blocks[j]; jatom<blocks[j+1]; ++jatom) {
           double distance = delta( getReferencePosition(iatom), getReferencePosition(jatom) ).modulo();
-          if(distance < upper && distance > lower ) targets[std::make_pair(iatom,jatom)] = distance;
+          if(distance < upper && distance > lower ) addTarget( iatom, jatom, distance );
         }
       }
     }
   }
+  finaliseTargets();
 }
 
 }
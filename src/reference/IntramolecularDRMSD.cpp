@@ -53,14 +53,16 @@ void IntramolecularDRMSD::read( const PDB& pdb ) {
 void IntramolecularDRMSD::setup_targets() {
   plumed_massert( bounds_were_set, "I am missing a call to DRMSD::setBoundsOnDistances");
 
+  clearTargets();
   for(unsigned i=0; i<nblocks; ++i) {
     for(unsigned iatom=blocks[i]+1; iatom<blocks[i+1]; ++iatom) {
       for(unsigned jatom=blocks[i]; jatom<iatom; ++jatom) {
         double distance = delta( getReferencePosition(iatom), getReferencePosition(jatom) ).modulo();
-        if(distance < upper && distance > lower ) targets[std::make_pair(iatom,jatom)] = distance;
+        if(distance < upper && distance > lower ) addTarget( iatom, jatom, distance );
       }
     }
   }
+  finaliseTargets();
 }
 
 }
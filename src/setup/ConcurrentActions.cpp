@@ -0,0 +1,150 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2012-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "core/ActionSetup.h"
+#include "core/ActionRegister.h"
+#include "core/PlumedMain.h"
+#include "tools/Communicator.h"
+#include "tools/OpenMP.h"
+#include "tools/Exception.h"
+
+using namespace std;
+
+namespace PLMD {
+namespace setup {
+
+//+PLUMEDOC GENERIC CONCURRENT_ACTIONS
+/*
+Calculate independent actions at the same time.
+
+This is a Setup directive and, as such, should appear
+at the beginning of the input file.
+
+By default PLUMED calculates the actions one at a time, in the order in which they appear in
+the input. When this directive is present, the actions are grouped at every step in levels, so that
+each action only depends on actions (arguments or virtual atoms) in the previous levels.
+The actions in a level are then calculated concurrently using up to THREADS openMP threads.
+This is useful when the input contains many inexpensive collective variables, which
+would otherwise leave all but one core idle.
+The forces are applied in the reverse order, with the actions that only act on atoms applied concurrently.
+
+Actions without a value (e.g. \ref WHOLEMOLECULES or \ref PRINT), actions that might modify the positions of the atoms
+(e.g. \ref FIT_TO_TEMPLATE) and actions that are computing numerical derivatives are calculated alone.
+Messages written on the log by actions calculated concurrently might appear in a different order.
+
+Each action calculated concurrently can use THREADS_PER_ACTION openMP threads for its own
+parallel loops. This number can be changed for specific actions with ACTION_THREADS, where
+the labels should be those of actions defined in the input.
+Notice that, in this case, the total number of threads can be as large as THREADS times the number of threads
+of each action.
+
+Actions are calculated one at a time, even if this directive is present, when PLUMED runs on more than one process
+(including multiple replicas), when MPI was not initialized with MPI_THREAD_MULTIPLE support, or when
+detailed timers are switched on with \ref DEBUG.
+Notice that because of the different order in which forces are accumulated results might differ
+from those obtained calculating actions one at a time in the last digits.
+
+\par Examples
+
+In the following input the ten distances are calculated at the same time using four threads,
+and so are the two restraints. The torsion is allowed to use two threads for its own calculation.
+\plumedfile
+CONCURRENT_ACTIONS THREADS=4 ACTION_THREADS=t:2
+d1: DISTANCE ATOMS=1,2
+d2: DISTANCE ATOMS=3,4
+d3: DISTANCE ATOMS=5,6
+d4: DISTANCE ATOMS=7,8
+d5: DISTANCE ATOMS=9,10
+d6: DISTANCE ATOMS=11,12
+d7: DISTANCE ATOMS=13,14
+d8: DISTANCE ATOMS=15,16
+d9: DISTANCE ATOMS=17,18
+d10: DISTANCE ATOMS=19,20
+t: TORSION ATOMS=1,2,3,4
+r1: RESTRAINT ARG=d1,d2,d3,d4,d5 AT=1,1,1,1,1 KAPPA=10,10,10,10,10
+r2: RESTRAINT ARG=d6,d7,d8,d9,d10,t AT=1,1,1,1,1,0 KAPPA=10,10,10,10,10,10
+\endplumedfile
+
+*/
+//+ENDPLUMEDOC
+
+class ConcurrentActions :
+  public virtual ActionSetup
+{
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit ConcurrentActions(const ActionOptions&ao);
+};
+
+PLUMED_REGISTER_ACTION(ConcurrentActions,"CONCURRENT_ACTIONS")
+
+void ConcurrentActions::registerKeywords( Keywords& keys ) {
+  ActionSetup::registerKeywords(keys);
+  keys.add("compulsory","THREADS","the maximum number of actions that are calculated at the same time");
+  keys.add("compulsory","THREADS_PER_ACTION","1","the number of openMP threads that each action can use for its own calculation");
+  keys.add("optional","ACTION_THREADS","a comma separated list of label:threads pairs, giving the number of openMP threads of specific actions");
+}
+
+ConcurrentActions::ConcurrentActions(const ActionOptions&ao):
+  Action(ao),
+  ActionSetup(ao)
+{
+  unsigned nt=0;
+  parse("THREADS",nt);
+  if(nt==0) error("THREADS should be positive");
+  unsigned npa=1;
+  parse("THREADS_PER_ACTION",npa);
+  if(npa==0) error("THREADS_PER_ACTION should be positive");
+  vector<string> athreads;
+  parseVector("ACTION_THREADS",athreads);
+  checkRead();
+
+  std::map<std::string,unsigned> budgets;
+  unsigned maxbudget=npa;
+  for(const auto & a : athreads) {
+    size_t colon=a.find_last_of(':');
+    unsigned n=0;
+    if(colon==string::npos || !Tools::convert(a.substr(colon+1),n) || n==0) error("cannot interpret " + a + " in ACTION_THREADS, it should be label:threads");
+    budgets[a.substr(0,colon)]=n;
+    if(n>maxbudget) maxbudget=n;
+  }
+
+  log.printf("  calculating up to %u actions at the same time\n",nt);
+  log.printf("  each action can use %u openMP threads\n",npa);
+  for(const auto & b : budgets) log.printf("  action %s can use %u openMP threads\n",b.first.c_str(),b.second);
+
+  if(comm.Get_size()>1 || multi_sim_comm.Get_size()>1) {
+    log.printf("  WARNING: running on more than one process, actions will be calculated one at a time\n");
+    return;
+  }
+  if(!Communicator::threadSafe()) {
+    log.printf("  WARNING: MPI does not support MPI_THREAD_MULTIPLE, actions will be calculated one at a time\n");
+    return;
+  }
+  plumed.concurrentActions=nt;
+  plumed.threadsPerAction=npa;
+  plumed.actionThreads=budgets;
+// actions need nested parallel regions to use more than one thread
+  if(maxbudget>1) OpenMP::setMaxActiveLevels(2);
+}
+
+}
+}
@@ -26,6 +26,7 @@
 #include "KernelFunctions.h"
 #include "File.h"
 #include "Grid.h"
+#include "OpenMP.h"
 
 
 namespace PLMD {
@@ -33,7 +34,7 @@ namespace PLMD {
 using namespace std;
 
 /// the constructor here
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc ):hasgrid(false),rescaledToBias(false),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc ):hasgrid(false),rescaledToBias(false),nflushed(0),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -44,7 +45,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
   }
 }
 /// overload the constructor: add the sigma  at constructor time
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc,  const vector<double> & sigma ):hasgrid(false), rescaledToBias(false), histosigma(sigma),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc,  const vector<double> & sigma ):hasgrid(false), rescaledToBias(false), histosigma(sigma),nflushed(0),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -56,7 +57,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
 }
 /// overload the constructor: add the grid at constructor time
 BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax,
-                                       const vector<unsigned> & nbin, bool doInt, double lowI, double uppI ):hasgrid(false), rescaledToBias(false), mycomm(cc) {
+                                       const vector<unsigned> & nbin, bool doInt, double lowI, double uppI ):hasgrid(false), rescaledToBias(false), nflushed(0),mycomm(cc) {
   ndim=tmpvalues.size();
   for(int  i=0; i<ndim; i++) {
     values.push_back(tmpvalues[i]);
@@ -69,7 +70,7 @@ BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communi
   addGrid(gmin,gmax,nbin);
 }
 /// overload the constructor with some external sigmas: needed for histogram
-BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax, const vector<unsigned> & nbin, const vector<double> & sigma):hasgrid(false), rescaledToBias(false),histosigma(sigma),mycomm(cc) {
+BiasRepresentation::BiasRepresentation(const vector<Value*> & tmpvalues, Communicator &cc, const vector<string> & gmin, const vector<string> & gmax, const vector<unsigned> & nbin, const vector<double> & sigma):hasgrid(false), rescaledToBias(false),histosigma(sigma),nflushed(0),mycomm(cc) {
   lowI_=0.0;
   uppI_=0.0;
   doInt_=false;
@@ -158,63 +159,7 @@ void BiasRepresentation::pushKernel( IFile *ifile ) {
       plumed_massert(maxi==maxv,"the input periodicity in hills and in value definition does not match"  );
     }
   }
-  // if grid is defined then it should be added on the grid
-  //cerr<<"now with "<<hills.size()<<endl;
-  if(hasgrid) {
-    vector<unsigned> nneighb;
-    if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
-      nneighb=BiasGrid_->getNbin();
-    } else nneighb=kk->getSupport(BiasGrid_->getDx());
-    vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
-    vector<double> der(ndim);
-    vector<double> xx(ndim);
-    if(mycomm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=0.0;}
-        BiasGrid_->getPoint(ineigh,xx);
-        // assign xx to a new vector of values
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        double bias;
-        if(doInt_) bias=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else bias=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          bias*=f;
-          for(int j=0; j<ndim; ++j) {der[j]*=f;}
-        }
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=mycomm.Get_size();
-      unsigned rank=mycomm.Get_rank();
-      vector<double> allder(ndim*neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      vector<double> tmpder(ndim);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        for(int j=0; j<ndim; ++j) {values[j]->set(xx[j]);}
-        if(doInt_) allbias[i]=kk->evaluate(values,der,true,doInt_,lowI_,uppI_);
-        else allbias[i]=kk->evaluate(values,der,true);
-        if(rescaledToBias) {
-          double f=(biasf.back()-1.)/(biasf.back());
-          allbias[i]*=f;
-          for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
-        }
-        // this solution with the temporary vector is rather bad, probably better to take
-        // a pointer of double as it was in old gaussian
-        for(int j=0; j<ndim; ++j) { allder[ndim*i+j]=tmpder[j]; tmpder[j]=0.;}
-      }
-      mycomm.Sum(allbias);
-      mycomm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(int j=0; j<ndim; ++j) {der[j]=allder[ndim*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
-      }
-    }
-  }
+  // if grid is defined the kernel will be added on the grid by flushKernels
   hills.emplace_back(std::move(kk));
 }
 int BiasRepresentation::getNumberOfKernels() {
@@ -222,8 +167,89 @@ int BiasRepresentation::getNumberOfKernels() {
 }
 Grid* BiasRepresentation::getGridPtr() {
   plumed_massert(hasgrid,"if you want the grid pointer then you should have defined a grid before");
+  flushKernels();
   return BiasGrid_.get();
 }
+void BiasRepresentation::evaluateKernel(unsigned k, const vector<Value*> & pos, vector<Grid::index_t> & neighbors, vector<double> & bias, vector<double> & der) {
+  const KernelFunctions* kk=hills[k].get();
+  vector<unsigned> nneighb;
+  if(doInt_&&(kk->getCenter()[0]+kk->getContinuousSupport()[0] > uppI_ || kk->getCenter()[0]-kk->getContinuousSupport()[0] < lowI_ )) {
+    nneighb=BiasGrid_->getNbin();
+  } else nneighb=kk->getSupport(BiasGrid_->getDx());
+  neighbors=BiasGrid_->getNeighbors(kk->getCenter(),nneighb);
+  bias.resize(neighbors.size());
+  der.resize(ndim*neighbors.size());
+  vector<double> xx(ndim),tmpder(ndim);
+  for(unsigned i=0; i<neighbors.size(); ++i) {
+    BiasGrid_->getPoint(neighbors[i],xx);
+    for(int j=0; j<ndim; ++j) {pos[j]->set(xx[j]); tmpder[j]=0.0;}
+    if(doInt_) bias[i]=kk->evaluate(pos,tmpder,true,doInt_,lowI_,uppI_);
+    else bias[i]=kk->evaluate(pos,tmpder,true);
+    if(rescaledToBias) {
+      double f=(biasf[k]-1.)/(biasf[k]);
+      bias[i]*=f;
+      for(int j=0; j<ndim; ++j) {tmpder[j]*=f;}
+    }
+    for(int j=0; j<ndim; ++j) der[ndim*i+j]=tmpder[j];
+  }
+}
+void BiasRepresentation::flushKernels() {
+  if(!hasgrid || nflushed==hills.size()) return;
+  const unsigned nhills=hills.size();
+  const unsigned stride=mycomm.Get_size();
+  const unsigned rank=mycomm.Get_rank();
+  const unsigned nt=OpenMP::getNumThreads();
+  vector<Grid::index_t> neighbors;
+  vector<double> bias,der,dd(ndim);
+  if(stride==1 && nt==1) {
+    // serial: kernels are added one by one, in the order they were read
+    for(unsigned k=nflushed; k<nhills; ++k) {
+      evaluateKernel(k,values,neighbors,bias,der);
+      for(unsigned i=0; i<neighbors.size(); ++i) {
+        for(int j=0; j<ndim; ++j) dd[j]=der[ndim*i+j];
+        BiasGrid_->addValueAndDerivatives(neighbors[i],bias[i],dd);
+      }
+    }
+  } else {
+    // kernels are split among processes and threads, each of them accumulating
+    // on a private copy of the grid; the copies are then summed once
+    const Grid::index_t npoints=BiasGrid_->getSize();
+    const unsigned nstore=ndim+1;
+    vector<double> buffer(nstore*npoints,0.0);
+    #pragma omp parallel num_threads(nt)
+    {
+      vector<double> mybuffer(nstore*npoints,0.0);
+      // values are used as scratch space by the kernels, so each thread needs its own
+      vector<std::unique_ptr<Value>> myvalues;
+      vector<Value*> mypos;
+      for(int j=0; j<ndim; ++j) {
+        myvalues.emplace_back(new Value(*values[j]));
+        mypos.push_back(myvalues[j].get());
+      }
+      vector<Grid::index_t> myneighbors;
+      vector<double> mybias,myder;
+      #pragma omp for schedule(dynamic,16)
+      for(unsigned k=nflushed+rank; k<nhills; k+=stride) {
+        evaluateKernel(k,mypos,myneighbors,mybias,myder);
+        for(unsigned i=0; i<myneighbors.size(); ++i) {
+          double* p=&mybuffer[nstore*myneighbors[i]];
+          p[0]+=mybias[i];
+          for(int j=0; j<ndim; ++j) p[1+j]+=myder[ndim*i+j];
+        }
+      }
+      #pragma omp critical
+      for(unsigned i=0; i<buffer.size(); ++i) buffer[i]+=mybuffer[i];
+    }
+    mycomm.Sum(buffer);
+    for(Grid::index_t i=0; i<npoints; ++i) {
+      const double* p=&buffer[nstore*i];
+      bool nonzero=(p[0]!=0.0);
+      for(int j=0; j<ndim; ++j) {dd[j]=p[1+j]; if(dd[j]!=0.0) nonzero=true;}
+      if(nonzero) BiasGrid_->addValueAndDerivatives(i,p[0],dd);
+    }
+  }
+  nflushed=nhills;
+}
 void BiasRepresentation::getMinMaxBin(vector<double> &vmin, vector<double> &vmax, vector<unsigned> &vbin) {
   vector<double> ss,cc,binsize;
   vmin.clear(); vmin.resize(ndim,10.e20);
@@ -260,6 +286,8 @@ void BiasRepresentation::getMinMaxBin(vector<double> &vmin, vector<double> &vmax
 }
 void BiasRepresentation::clear() {
   hills.clear();
+  biasf.clear();
+  nflushed=0;
   // clear the grid
   if(hasgrid) {
     BiasGrid_->clear();
@@ -77,8 +77,10 @@ public:
   const std::string & getName(unsigned i);
   /// get a pointer to a specific value
   Value* 	getPtrToValue(unsigned i);
-  /// get the pointer to the grid
+  /// get the pointer to the grid (the kernels pushed so far are added to it first)
   Grid* 	getGridPtr();
+  /// add to the grid all the kernels that have been pushed since the last call
+  void 		flushKernels();
   /// get a new histogram point from a file
   std::unique_ptr<KernelFunctions> readFromPoint(IFile *ifile);
   /// get an automatic min/max from the set so to know how to configure the grid
@@ -86,6 +88,8 @@ public:
   /// clear the representation (grid included)
   void clear();
 private:
+  /// compute the contribution of the k-th kernel on the neighboring grid points
+  void evaluateKernel(unsigned k, const std::vector<Value*> & pos, std::vector<std::size_t> & neighbors, std::vector<double> & bias, std::vector<double> & der);
   int ndim;
   bool hasgrid;
   bool rescaledToBias;
@@ -97,6 +101,8 @@ private:
   std::vector<std::unique_ptr<KernelFunctions>> hills;
   std::vector<double> biasf;
   std::vector<double> histosigma;
+  /// number of kernels that have already been added to the grid
+  unsigned nflushed;
   Communicator& mycomm;
   std::unique_ptr<Grid> BiasGrid_;
 };
@@ -169,6 +169,9 @@ public:
   void Barrier()const;
 /// Tests if MPI library is initialized
   static bool initialized();
+/// Tests if MPI library can be called from concurrent threads,
+/// that is it is not initialized or it provides MPI_THREAD_MULTIPLE
+  static bool threadSafe();
 
 /// Returns MPI_COMM_WORLD if MPI is initialized, otherwise the default communicator
   static Communicator & Get_world();
@@ -35,6 +35,8 @@
 #include <sstream>
 #include <cstdio>
 #include <cfloat>
+#include <algorithm>
+#include <limits>
 
 using namespace std;
 namespace PLMD {
@@ -676,33 +678,90 @@ std::unique_ptr<Grid> Grid::create(const std::string& funcl, const std::vector<V
   if(!dosparse) {grid.reset(new Grid(funcl,args,gmin,gmax,gbin,dospline,doder));}
   else {grid.reset(new SparseGrid(funcl,args,gmin,gmax,gbin,dospline,doder));}
 
+// Read all the data at once: the columns are looked up only once
+  std::vector<std::string> columns;
+  columns.push_back(funcl);
+  for(unsigned i=0; i<nvar; ++i) columns.push_back(labels[i]);
+  if(hasder) { for(unsigned i=0; i<nvar; ++i) columns.push_back( "der_" + args[i]->getName() ); }
+  std::vector<double> data;
+  ifile.scanRows(columns,data);
+
   vector<double> xx(nvar),dder(nvar);
   vector<double> dx=grid->getDx();
-  double f,x;
-  while( ifile.scanField(funcl,f) ) {
-    for(unsigned i=0; i<nvar; ++i) {
-      ifile.scanField(labels[i],x); xx[i]=x+dx[i]/2.0;
-      ifile.scanField( "min_" + labels[i], gmin[i]);
-      ifile.scanField( "max_" + labels[i], gmax[i]);
-      ifile.scanField( "nbins_" + labels[i], gbin1[i]);
-      ifile.scanField( "periodic_" + labels[i], pstring );
-    }
-    if(hasder) { for(unsigned i=0; i<nvar; ++i) { ifile.scanField( "der_" + args[i]->getName(), dder[i] ); } }
+  const unsigned ncol=columns.size();
+  for(std::size_t row=0; row+ncol<=data.size(); row+=ncol) {
+    double f=data[row];
+    for(unsigned i=0; i<nvar; ++i) xx[i]=data[row+1+i]+dx[i]/2.0;
+    if(hasder) { for(unsigned i=0; i<nvar; ++i) dder[i]=data[row+1+nvar+i]; }
     index_t index=grid->getIndex(xx);
     if(doder) {grid->setValueAndDerivatives(index,f,dder);}
     else {grid->setValue(index,f);}
-    ifile.scanField();
   }
   return grid;
 }
 
-// Sparse version of grid with map
+// Sparse version of grid with tiles
 void SparseGrid::clear() {
-  map_.clear();
+  hash_keys_.clear(); hash_tiles_.clear(); hash_shift_=0;
+  tiles_.clear(); values_.clear(); ders_.clear(); isset_.clear();
+  npoints_=0;
+}
+
+// Fibonacci hashing: the upper bits of the product are well mixed
+static inline unsigned long long sparseGridHash(unsigned long long tile,unsigned shift) {
+  return (tile*11400714819323198485ull)>>shift;
+}
+
+unsigned SparseGrid::findTile(index_t tile) const {
+  if(hash_keys_.empty()) return std::numeric_limits<unsigned>::max();
+  const index_t mask=hash_keys_.size()-1;
+  for(index_t h=sparseGridHash(tile,hash_shift_);; h=(h+1)&mask) {
+    if(hash_keys_[h]==tile) return hash_tiles_[h];
+    if(hash_keys_[h]==std::numeric_limits<index_t>::max()) return std::numeric_limits<unsigned>::max();
+  }
+}
+
+void SparseGrid::rehash(index_t size) {
+  unsigned bits=0;
+  while((index_t(1)<<bits)<size) bits++;
+  hash_keys_.assign(index_t(1)<<bits,std::numeric_limits<index_t>::max());
+  hash_tiles_.assign(index_t(1)<<bits,0);
+  hash_shift_=64-bits;
+  const index_t mask=hash_keys_.size()-1;
+  for(unsigned t=0; t<tiles_.size(); ++t) {
+    index_t h=sparseGridHash(tiles_[t],hash_shift_);
+    while(hash_keys_[h]!=std::numeric_limits<index_t>::max()) h=(h+1)&mask;
+    hash_keys_[h]=tiles_[t]; hash_tiles_[h]=t;
+  }
+}
+
+unsigned SparseGrid::getTile(index_t tile) {
+  unsigned t=findTile(tile);
+  if(t!=std::numeric_limits<unsigned>::max()) return t;
+// keep the table at most half full
+  if(2*(tiles_.size()+1)>hash_keys_.size()) rehash(std::max(index_t(16),2*hash_keys_.size()));
+  const index_t mask=hash_keys_.size()-1;
+  index_t h=sparseGridHash(tile,hash_shift_);
+  while(hash_keys_[h]!=std::numeric_limits<index_t>::max()) h=(h+1)&mask;
+  t=tiles_.size();
+  hash_keys_[h]=tile; hash_tiles_[h]=t;
+  tiles_.push_back(tile);
+  const index_t tile_size=index_t(1)<<tile_bits_;
+  values_.resize(values_.size()+tile_size,0.0);
+  isset_.resize(isset_.size()+tile_size,0);
+  if(usederiv_) ders_.resize(ders_.size()+tile_size*dimension_,0.0);
+  return t;
+}
+
+Grid::index_t SparseGrid::touch(index_t index) {
+  const index_t tile_size=index_t(1)<<tile_bits_;
+  const index_t pos=getTile(index>>tile_bits_)*tile_size+(index&(tile_size-1));
+  if(!isset_[pos]) { isset_[pos]=1; npoints_++; }
+  return pos;
 }
 
 Grid::index_t SparseGrid::getSize() const {
-  return map_.size();
+  return npoints_;
 }
 
 Grid::index_t SparseGrid::getMaxSize() const {
@@ -758,47 +817,48 @@ void Grid::findSetOfPointsOnContour(const double& target, const std::vector<bool
 
 double SparseGrid::getValue(index_t index)const {
   plumed_assert(index<maxsize_);
-  double value=0.0;
-  const auto it=map_.find(index);
-  if(it!=map_.end()) value=it->second;
-  return value;
+  const unsigned t=findTile(index>>tile_bits_);
+  if(t==std::numeric_limits<unsigned>::max()) return 0.0;
+  const index_t tile_size=index_t(1)<<tile_bits_;
+  return values_[t*tile_size+(index&(tile_size-1))];
 }
 
 double SparseGrid::getValueAndDerivatives
 (index_t index, vector<double>& der)const {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  double value=0.0;
   for(unsigned int i=0; i<dimension_; ++i) der[i]=0.0;
-  const auto it=map_.find(index);
-  if(it!=map_.end()) value=it->second;
-  const auto itder=der_.find(index);
-  if(itder!=der_.end()) der=itder->second;
-  return value;
+  const unsigned t=findTile(index>>tile_bits_);
+  if(t==std::numeric_limits<unsigned>::max()) return 0.0;
+  const index_t tile_size=index_t(1)<<tile_bits_;
+  const index_t pos=t*tile_size+(index&(tile_size-1));
+  for(unsigned int i=0; i<dimension_; ++i) der[i]=ders_[pos*dimension_+i];
+  return values_[pos];
 }
 
 void SparseGrid::setValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
-  map_[index]=value;
+  values_[touch(index)]=value;
 }
 
 void SparseGrid::setValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  map_[index]=value;
-  der_[index]=der;
+  const index_t pos=touch(index);
+  values_[pos]=value;
+  for(unsigned int i=0; i<dimension_; ++i) ders_[pos*dimension_+i]=der[i];
 }
 
 void SparseGrid::addValue(index_t index, double value) {
   plumed_assert(index<maxsize_ && !usederiv_);
-  map_[index]+=value;
+  values_[touch(index)]+=value;
 }
 
 void SparseGrid::addValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  map_[index]+=value;
-  der_[index].resize(dimension_);
-  for(unsigned int i=0; i<dimension_; ++i) der_[index][i]+=der[i];
+  const index_t pos=touch(index);
+  values_[pos]+=value;
+  for(unsigned int i=0; i<dimension_; ++i) ders_[pos*dimension_+i]+=der[i];
 }
 
 void SparseGrid::writeToFile(OFile& ofile) {
@@ -807,23 +867,31 @@ void SparseGrid::writeToFile(OFile& ofile) {
   double f;
   writeHeader(ofile);
   ofile.fmtField(" "+fmt_);
-  for(const auto & it : map_) {
-    index_t i=it.first;
-    xx=getPoint(i);
-    if(usederiv_) {f=getValueAndDerivatives(i,der);}
-    else {f=getValue(i);}
-    if(i>0 && dimension_>1 && getIndices(i)[dimension_-2]==0) ofile.printf("\n");
-    for(unsigned j=0; j<dimension_; ++j) {
-      ofile.printField("min_" + argnames[j], str_min_[j] );
-      ofile.printField("max_" + argnames[j], str_max_[j] );
-      ofile.printField("nbins_" + argnames[j], static_cast<int>(nbin_[j]) );
-      if( pbc_[j] ) ofile.printField("periodic_" + argnames[j], "true" );
-      else          ofile.printField("periodic_" + argnames[j], "false" );
+// points are written in order of index
+  vector<index_t> sorted(tiles_);
+  std::sort(sorted.begin(),sorted.end());
+  const index_t tile_size=index_t(1)<<tile_bits_;
+  for(const auto & tile : sorted) {
+    const index_t start=findTile(tile)*tile_size;
+    for(index_t k=0; k<tile_size; ++k) {
+      if(!isset_[start+k]) continue;
+      index_t i=tile*tile_size+k;
+      xx=getPoint(i);
+      if(usederiv_) {f=getValueAndDerivatives(i,der);}
+      else {f=getValue(i);}
+      if(i>0 && dimension_>1 && getIndices(i)[dimension_-2]==0) ofile.printf("\n");
+      for(unsigned j=0; j<dimension_; ++j) {
+        ofile.printField("min_" + argnames[j], str_min_[j] );
+        ofile.printField("max_" + argnames[j], str_max_[j] );
+        ofile.printField("nbins_" + argnames[j], static_cast<int>(nbin_[j]) );
+        if( pbc_[j] ) ofile.printField("periodic_" + argnames[j], "true" );
+        else          ofile.printField("periodic_" + argnames[j], "false" );
+      }
+      for(unsigned j=0; j<dimension_; ++j) ofile.printField(argnames[j],xx[j]);
+      ofile.printField(funcname, f);
+      if(usederiv_) { for(unsigned j=0; j<dimension_; ++j) ofile.printField("der_" + argnames[j],der[j]); }
+      ofile.printField();
     }
-    for(unsigned j=0; j<dimension_; ++j) ofile.printField(argnames[j],xx[j]);
-    ofile.printField(funcname, f);
-    if(usederiv_) { for(unsigned j=0; j<dimension_; ++j) ofile.printField("der_" + argnames[j],der[j]); }
-    ofile.printField();
   }
 }
 
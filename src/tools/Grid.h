@@ -230,9 +230,30 @@ public:
 
 class SparseGrid : public Grid
 {
-
-  std::map<index_t,double> map_;
-  std::map< index_t,std::vector<double> > der_;
+/// Points are stored in tiles of 2^tile_bits_ consecutive indexes.
+/// Tiles are allocated when first touched and found through an open addressing hash table.
+  static const unsigned tile_bits_=6;
+/// Hash table: tile numbers (or an empty marker) and their position in the storage
+  std::vector<index_t> hash_keys_;
+  std::vector<unsigned> hash_tiles_;
+/// Shift used to compute the hash of a tile number
+  unsigned hash_shift_;
+/// Tile numbers in order of creation
+  std::vector<index_t> tiles_;
+/// Values, derivatives and flags for the points that have been set, tile by tile
+  std::vector<double> values_;
+  std::vector<double> ders_;
+  std::vector<char> isset_;
+/// Number of points that have been set
+  index_t npoints_;
+/// Find the position of a tile in the storage, returns the largest unsigned if it is not there
+  unsigned findTile(index_t tile) const;
+/// Find the position of a tile in the storage, creating it if needed
+  unsigned getTile(index_t tile);
+/// Rebuild the hash table with a new size
+  void rehash(index_t size);
+/// Mark a point as set and return its position in the storage
+  index_t touch(index_t index);
 
 protected:
   void clear();
@@ -241,7 +262,9 @@ public:
   SparseGrid(const std::string& funcl, const std::vector<Value*> & args, const std::vector<std::string> & gmin,
              const std::vector<std::string> & gmax,
              const std::vector<unsigned> & nbin, bool dospline, bool usederiv):
-    Grid(funcl,args,gmin,gmax,nbin,dospline,usederiv,false) {}
+    Grid(funcl,args,gmin,gmax,nbin,dospline,usederiv,false),
+    hash_shift_(0),
+    npoints_(0) {}
 
   index_t getSize() const;
   index_t getMaxSize() const;
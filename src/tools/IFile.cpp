@@ -27,6 +27,7 @@
 #include "Communicator.h"
 #include "Tools.h"
 #include <cstdarg>
+#include <cstdio>
 #include <cstring>
 #include <cmath>
 
@@ -58,16 +59,56 @@ size_t IFile::llread(char*ptr,size_t s) {
   return r;
 }
 
+bool IFile::splitDataLine(const std::string&line) {
+  wordbounds.clear();
+  const std::size_t n=line.length();
+  std::size_t i=0;
+  while(i<n) {
+    char c=line[i];
+    if(c=='#') break;
+    if(c=='{' || c=='}') return false;
+    if(c==' ' || c=='\t' || c=='\n') {i++; continue;}
+    wordbounds.push_back(i);
+    while(i<n) {
+      c=line[i];
+      if(c==' ' || c=='\t' || c=='\n' || c=='#') break;
+      if(c=='{' || c=='}') return false;
+      i++;
+    }
+    wordbounds.push_back(i);
+  }
+  return true;
+}
+
 IFile& IFile::advanceField() {
   plumed_assert(!inMiddleOfField);
-  std::string line;
+  std::string& line(linebuffer);
   bool done=false;
   while(!done) {
     getline(line);
     if(!*this) {return *this;}
+// Data lines are split in place, without creating a vector of words.
+// Lines starting with # (FIELDS, SET or comments) and lines with braces
+// go through the generic parser.
+    std::size_t first=line.find_first_not_of(" \t\n");
+    if(first!=std::string::npos && line[first]!='#' && splitDataLine(line)) {
+      unsigned nf=0;
+      for(unsigned i=0; i<fields.size(); i++) if(!fields[i].constant) nf++;
+      if(wordbounds.size()!=2*nf) plumed_merror("file " + getPath() + ": mismatch between number of fields in file and expected number");
+      unsigned j=0;
+      for(unsigned i=0; i<fields.size(); i++) {
+        if(fields[i].constant) continue;
+        fields[i].value.assign(line,wordbounds[2*j],wordbounds[2*j+1]-wordbounds[2*j]);
+        fields[i].read=false;
+        j++;
+      }
+      done=true;
+      continue;
+    }
     std::vector<std::string> words=Tools::getWords(line);
     if(words.size()>=2 && words[0]=="#!" && words[1]=="FIELDS") {
       fields.clear();
+      fieldsVersion++;
       for(unsigned i=2; i<words.size(); i++) {
         Field field;
         field.name=words[i];
@@ -79,6 +120,7 @@ IFile& IFile::advanceField() {
       field.value=words[3];
       field.constant=true;
       fields.push_back(field);
+      fieldsVersion++;
     } else {
       unsigned nf=0;
       for(unsigned i=0; i<fields.size(); i++) if(!fields[i].constant) nf++;
@@ -162,6 +204,63 @@ IFile& IFile::scanField(const std::string&name,int &x) {
   return *this;
 }
 
+unsigned IFile::getFieldIndex(const std::string&name) {
+  if(!inMiddleOfField) advanceField();
+  if(!*this) return 0;
+  return findField(name);
+}
+
+IFile& IFile::scanField(unsigned i,std::string&str) {
+  if(!inMiddleOfField) advanceField();
+  if(!*this) return *this;
+  plumed_dbg_assert(i<fields.size());
+  str=fields[i].value;
+  fields[i].read=true;
+  return *this;
+}
+
+IFile& IFile::scanField(unsigned i,double &x) {
+  if(!inMiddleOfField) advanceField();
+  if(!*this) return *this;
+  plumed_dbg_assert(i<fields.size());
+  Tools::convert(fields[i].value,x);
+  fields[i].read=true;
+  return *this;
+}
+
+IFile& IFile::scanField(unsigned i,int &x) {
+  if(!inMiddleOfField) advanceField();
+  if(!*this) return *this;
+  plumed_dbg_assert(i<fields.size());
+  Tools::convert(fields[i].value,x);
+  fields[i].read=true;
+  return *this;
+}
+
+IFile& IFile::scanRows(const std::vector<std::string>&names,std::vector<double>&data) {
+  std::vector<unsigned> index(names.size());
+  bool resolved=false;
+  unsigned version=0;
+  while(true) {
+    if(!inMiddleOfField) advanceField();
+    if(!*this) break;
+    if(!resolved || version!=fieldsVersion) {
+      for(unsigned i=0; i<names.size(); i++) index[i]=findField(names[i]);
+      version=fieldsVersion;
+      resolved=true;
+    }
+    for(unsigned i=0; i<names.size(); i++) {
+      double x=NAN; // this is to be sure a NAN value is stored upon failure
+      Tools::convert(fields[index[i]].value,x);
+      fields[index[i]].read=true;
+      data.push_back(x);
+    }
+    for(unsigned i=0; i<fields.size(); i++) if(fields[i].constant) fields[i].read=true;
+    scanField();
+  }
+  return *this;
+}
+
 IFile& IFile::scanField(Value* val) {
   double ff=NAN; // this is to be sure a NAN value is replaced upon failure
   scanField(  val->getName(), ff );
@@ -190,7 +289,8 @@ IFile& IFile::scanField() {
 IFile::IFile():
   inMiddleOfField(false),
   ignoreFields(false),
-  noEOL(false)
+  noEOL(false),
+  fieldsVersion(0)
 {
 }
 
@@ -200,14 +300,27 @@ IFile::~IFile() {
 
 IFile& IFile::getline(std::string &str) {
   char tmp=0;
-  str="";
+  str.clear();
   fpos_t pos;
   fgetpos(fp,&pos);
-  while(llread(&tmp,1)==1 && tmp && tmp!='\n' && tmp!='\r' && !eof && !err) {
+// plain files are read character by character from the stdio buffer,
+// which is much cheaper than calling fread for each character
+  auto readChar=[&](char&c) {
+    if(gzfp) return llread(&c,1);
+    int r=std::getc(fp);
+    if(r==EOF) {
+      if(feof(fp))   eof=true;
+      if(ferror(fp)) err=true;
+      return size_t(0);
+    }
+    c=r;
+    return size_t(1);
+  };
+  while(readChar(tmp)==1 && tmp && tmp!='\n' && tmp!='\r' && !eof && !err) {
     str+=tmp;
   }
   if(tmp=='\r') {
-    llread(&tmp,1);
+    readChar(tmp);
     plumed_massert(tmp=='\n',"plumed only accepts \\n (unix) or \\r\\n (dos) new lines");
   }
   if(eof && noEOL) {
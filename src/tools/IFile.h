@@ -57,6 +57,17 @@ class IFile:
   bool ignoreFields;
 /// Set to true to allow files without end-of-line at the end
   bool noEOL;
+/// Incremented every time the list of fields changes
+/// (that is, when a FIELDS or SET line is found)
+  unsigned fieldsVersion;
+/// Buffer for the line being parsed
+  std::string linebuffer;
+/// Begin and end of the words found in the last data line
+  std::vector<std::size_t> wordbounds;
+/// Split a data line into the non-constant fields without
+/// allocating new strings. Returns false if the line requires the
+/// generic parser (e.g. it contains braces).
+  bool splitDataLine(const std::string&);
 /// Advance to next field (= read one line)
   IFile& advanceField();
 /// Find field index by name
@@ -76,6 +87,31 @@ public:
   IFile& scanField(const std::string&,int&);
 /// Read a string field
   IFile& scanField(const std::string&,std::string&);
+/// Get the index of a field, to be used with the index based scanField.
+/// The index is valid until the FIELDS or SET lines change, which can be
+/// checked with getFieldsVersion()
+  unsigned getFieldIndex(const std::string&);
+/// Get a counter that is incremented every time the list of fields changes
+  unsigned getFieldsVersion()const {return fieldsVersion;}
+/// Read a double field by index
+  IFile& scanField(unsigned,double&);
+/// Read a int field by index
+  IFile& scanField(unsigned,int&);
+/// Read a string field by index
+  IFile& scanField(unsigned,std::string&);
+  /**
+   Read all the remaining lines of the file, appending the values of the
+   requested columns to a flat array (row major). Field names are only
+   resolved again when a new FIELDS or SET line is found. Fields that are set
+   as constants with SET are not required to be listed.
+
+  Typically used as
+  \verbatim
+    std::vector<double> data;
+    if.scanRows({"time","cv"},data);
+  \endverbatim
+  */
+  IFile& scanRows(const std::vector<std::string>&,std::vector<double>&);
   /**
    Ends a field-formatted line.
 
@@ -22,6 +22,7 @@
 #include "LinkCells.h"
 #include "Communicator.h"
 #include "Tools.h"
+#include "OpenMP.h"
 
 namespace PLMD {
 
@@ -52,7 +53,7 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
 
   // Setup the lists
   if( pos.size()!=allcells.size() ) {
-    allcells.resize( pos.size() ); lcell_lists.resize( pos.size() );
+    allcells.resize( pos.size() ); lcell_lists.resize( pos.size() ); lcell_pos.resize( pos.size() );
   }
 
   {
@@ -77,27 +78,23 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
   }
   // Clear nlcells
   for(unsigned i=0; i<ncellstot; ++i) lcell_tots[i]=0;
-  // Clear allcells
-  allcells.assign( allcells.size(), 0 );
-
-  // Find out what cell everyone is in
-  unsigned rank=comm.Get_rank(), size=comm.Get_size();
-  for(unsigned i=rank; i<pos.size(); i+=size) {
-    allcells[i]=findCell( pos[i] );
-    lcell_tots[allcells[i]]++;
-  }
-  // And gather all this information on every node
-  comm.Sum( allcells ); comm.Sum( lcell_tots );
+
+  // Find out what cell everyone is in. This is done by every node on all the atoms,
+  // which is cheaper than summing arrays as large as the number of atoms
+  #pragma omp parallel for num_threads(OpenMP::getGoodNumThreads(allcells))
+  for(unsigned i=0; i<pos.size(); ++i) allcells[i]=findCell( pos[i] );
+  for(unsigned i=0; i<pos.size(); ++i) lcell_tots[allcells[i]]++;
 
   // Now prepare the link cell lists
   unsigned tot=0;
   for(unsigned i=0; i<lcell_tots.size(); ++i) { lcell_starts[i]=tot; tot+=lcell_tots[i]; lcell_tots[i]=0; }
   plumed_assert( tot==pos.size() );
 
-  // And setup the link cells properly
+  // And setup the link cells properly, storing the positions in the same order
   for(unsigned j=0; j<pos.size(); ++j) {
     unsigned myind = lcell_starts[ allcells[j] ] + lcell_tots[ allcells[j] ];
     lcell_lists[ myind ] = indices[j];
+    lcell_pos[ myind ] = pos[j];
     lcell_tots[allcells[j]]++;
   }
 }
@@ -108,6 +105,12 @@ void LinkCells::buildCellLists( const std::vector<Vector>& pos, const std::vecto
 
 void LinkCells::addRequiredCells( const std::vector<unsigned>& celn, unsigned& ncells_required,
                                   std::vector<unsigned>& cells_required ) const {
+  plumed_dbg_assert( celn.size()==3 );
+  addRequiredCells( &celn[0], ncells_required, cells_required );
+}
+
+void LinkCells::addRequiredCells( const unsigned* celn, unsigned& ncells_required,
+                                  std::vector<unsigned>& cells_required ) const {
   unsigned nnew_cells=0;
   for(int nx=LINKC_MIN(ncells[0]); nx<LINKC_MAX(ncells[0]); ++nx) {
     int xval = celn[0] + nx;
@@ -130,10 +133,43 @@ void LinkCells::addRequiredCells( const std::vector<unsigned>& celn, unsigned& n
   ncells_required += nnew_cells;
 }
 
+void LinkCells::addRequiredCells( const unsigned* celn, const unsigned& nshell, unsigned& ncells_required,
+                                  std::vector<unsigned>& cells_required ) const {
+  // When there are not enough cells in one direction all of them are taken once
+  int lower[3], upper[3]; unsigned nnew_cells=1;
+  for(unsigned k=0; k<3; ++k) {
+    if( ncells[k]<2*nshell+1 ) { lower[k]=0; upper[k]=ncells[k]; }
+    else { lower[k]=-int(nshell); upper[k]=nshell+1; }
+    nnew_cells*=upper[k]-lower[k];
+  }
+  if( cells_required.size()<ncells_required+nnew_cells ) cells_required.resize( ncells_required+nnew_cells );
+  for(int nx=lower[0]; nx<upper[0]; ++nx) {
+    unsigned xval=( (celn[0]+nx+ncells[0])%ncells[0] )*nstride[0];
+    for(int ny=lower[1]; ny<upper[1]; ++ny) {
+      unsigned yval=( (celn[1]+ny+ncells[1])%ncells[1] )*nstride[1];
+      for(int nz=lower[2]; nz<upper[2]; ++nz) {
+        unsigned zval=( (celn[2]+nz+ncells[2])%ncells[2] )*nstride[2];
+        cells_required[ncells_required]=xval+yval+zval; ncells_required++;
+      }
+    }
+  }
+}
+
+void LinkCells::addRequiredHalfShellCells( const unsigned& cell, const unsigned& nshell, unsigned& ncells_required,
+    std::vector<unsigned>& cells_required ) const {
+  unsigned celn[3];
+  celn[0]=cell%ncells[0]; celn[1]=(cell/nstride[1])%ncells[1]; celn[2]=cell/nstride[2];
+  unsigned nall=ncells_required; addRequiredCells( celn, nshell, nall, cells_required );
+  for(unsigned k=ncells_required; k<nall; ++k) {
+    if( cells_required[k]>cell ) { cells_required[ncells_required]=cells_required[k]; ncells_required++; }
+  }
+}
+
 void LinkCells::retrieveNeighboringAtoms( const Vector& pos, std::vector<unsigned>& cell_list,
     unsigned& natomsper, std::vector<unsigned>& atoms ) const {
   if( cell_list.size()!=getNumberOfCells() ) cell_list.resize( getNumberOfCells() );
-  unsigned ncellt=0; addRequiredCells( findMyCell( pos ), ncellt, cell_list );
+  unsigned celn[3]; findMyCell( pos, celn );
+  unsigned ncellt=0; addRequiredCells( celn, ncellt, cell_list );
   retrieveAtomsInCells( ncellt, cell_list, natomsper, atoms );
 }
 
@@ -154,12 +190,16 @@ void LinkCells::retrieveAtomsInCells( const unsigned& ncells_required,
 }
 
 std::vector<unsigned> LinkCells::findMyCell( const Vector& pos ) const {
-  Vector fpos=mypbc.realToScaled( pos ); std::vector<unsigned> celn(3);
+  std::vector<unsigned> celn(3); findMyCell( pos, &celn[0] );
+  return celn;
+}
+
+void LinkCells::findMyCell( const Vector& pos, unsigned* celn ) const {
+  Vector fpos=mypbc.realToScaled( pos );
   for(unsigned j=0; j<3; ++j) {
     celn[j] = std::floor( ( Tools::pbc(fpos[j]) + 0.5 ) * ncells[j] );
     plumed_assert( celn[j]>=0 && celn[j]<ncells[j] ); // Check that atom is in box
   }
-  return celn;
 }
 
 unsigned LinkCells::convertIndicesToIndex( const unsigned& nx, const unsigned& ny, const unsigned& nz ) const {
@@ -167,7 +207,7 @@ unsigned LinkCells::convertIndicesToIndex( const unsigned& nx, const unsigned& n
 }
 
 unsigned LinkCells::findCell( const Vector& pos ) const {
-  std::vector<unsigned> celn( findMyCell(pos ) );
+  unsigned celn[3]; findMyCell( pos, celn );
   return convertIndicesToIndex( celn[0], celn[1], celn[2] );
 }
 
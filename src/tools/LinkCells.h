@@ -54,6 +54,8 @@ private:
   std::vector<unsigned> lcell_tots;
 /// The atoms ordered by link cells
   std::vector<unsigned> lcell_lists;
+/// The positions of the atoms ordered by link cells
+  std::vector<Vector> lcell_pos;
 public:
 ///
   explicit LinkCells( Communicator& comm );
@@ -73,13 +75,33 @@ public:
   unsigned findCell( const Vector& pos ) const ;
 /// Find the cell in which this position is contained
   std::vector<unsigned> findMyCell( const Vector& pos ) const ;
+/// Find the cell in which this position is contained without allocating memory
+  void findMyCell( const Vector& pos, unsigned* celn ) const ;
 /// Get the list of cells we need to surround the a particular cell
   void addRequiredCells( const std::vector<unsigned>& celn, unsigned& ncells_required,
                          std::vector<unsigned>& cells_required ) const ;
+  void addRequiredCells( const unsigned* celn, unsigned& ncells_required,
+                         std::vector<unsigned>& cells_required ) const ;
+/// Get the cells that are at most nshell cells away from a particular cell in each direction.
+/// With cells smaller than the cutoff by a factor nshell, this list contains all the atoms within the cutoff.
+/// Each cell is only listed once and cells_required is resized if needed
+  void addRequiredCells( const unsigned* celn, const unsigned& nshell, unsigned& ncells_required,
+                         std::vector<unsigned>& cells_required ) const ;
+/// Get the cells in the half shell of a cell, i.e. the cells listed by addRequiredCells() whose
+/// index is larger than the index of the cell. Looping over the atoms of each cell and of the cells
+/// in its half shell visits every pair of atoms in neighbouring cells only once
+  void addRequiredHalfShellCells( const unsigned& cell, const unsigned& nshell, unsigned& ncells_required,
+                                  std::vector<unsigned>& cells_required ) const ;
 /// Retrieve the atoms in a list of cells
   void retrieveAtomsInCells( const unsigned& ncells_required,
                              const std::vector<unsigned>& cells_required,
                              unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
+/// Get the number of atoms in a cell
+  unsigned getNumberOfAtomsInCell( const unsigned& cell ) const ;
+/// Get the index of the k-th atom in a cell
+  unsigned getAtomInCell( const unsigned& cell, const unsigned& k ) const ;
+/// Get the position of the k-th atom in a cell
+  const Vector& getPositionInCell( const unsigned& cell, const unsigned& k ) const ;
 /// Retrieve the atoms we need to consider
   void retrieveNeighboringAtoms( const Vector& pos, std::vector<unsigned>& cell_list, unsigned& natomsper, std::vector<unsigned>& atoms ) const ;
 };
@@ -94,6 +116,21 @@ unsigned LinkCells::getNumberOfCells() const {
   return ncells[0]*ncells[1]*ncells[2];
 }
 
+inline
+unsigned LinkCells::getNumberOfAtomsInCell( const unsigned& cell ) const {
+  return lcell_tots[cell];
+}
+
+inline
+unsigned LinkCells::getAtomInCell( const unsigned& cell, const unsigned& k ) const {
+  return lcell_lists[lcell_starts[cell]+k];
+}
+
+inline
+const Vector& LinkCells::getPositionInCell( const unsigned& cell, const unsigned& k ) const {
+  return lcell_pos[lcell_starts[cell]+k];
+}
+
 }
 
 #endif
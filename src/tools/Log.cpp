@@ -21,3 +21,12 @@
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Log.h"
 
+namespace PLMD {
+
+Log::Log() {
+// actions calculated concurrently (see CONCURRENT_ACTIONS) can write on the log at the same time
+  setThreadSafe();
+}
+
+}
+
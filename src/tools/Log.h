@@ -35,6 +35,8 @@ namespace PLMD {
 class Log :
   public OFile
 {
+public:
+  Log();
 };
 
 }
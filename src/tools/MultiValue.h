@@ -64,6 +64,8 @@ public:
   void addValue( const unsigned&,  const double& );
 /// Add derivative
   void addDerivative( const unsigned&, const unsigned&, const double& );
+/// Add factor*der[k] to the derivative jder of the n values starting from ival
+  void addDerivatives( const unsigned& ival, const unsigned& n, const unsigned& jder, const double& factor, const double* der );
 /// Add to the tempory value
   void addTemporyValue( const double& val );
 /// Add tempory derivatives - this is used for calculating quotients
@@ -139,6 +141,13 @@ void MultiValue::addDerivative( const unsigned& ival, const unsigned& jder, cons
   hasDerivatives.activate(jder); derivatives[nderivatives*ival+jder] += der;
 }
 
+inline
+void MultiValue::addDerivatives( const unsigned& ival, const unsigned& n, const unsigned& jder, const double& factor, const double* der ) {
+  plumed_dbg_assert( ival+n<=values.size() && jder<nderivatives ); atLeastOneSet=true;
+  hasDerivatives.activate(jder);
+  for(unsigned k=0; k<n; ++k) derivatives[nderivatives*(ival+k)+jder] += factor*der[k];
+}
+
 inline
 void MultiValue::addTemporyValue( const double& val ) {
   tmpval += val;
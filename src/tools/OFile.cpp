@@ -36,6 +36,11 @@
 
 #include <memory>
 #include <utility>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
 
 #ifdef __PLUMED_HAS_ZLIB
 #include <zlib.h>
@@ -43,20 +48,142 @@
 
 namespace PLMD {
 
+/// Size of the chunks passed to the background writer
+static const size_t asyncChunkSize=65536;
+
+/// Background thread writing the data of an OFile in asynchronous mode.
+/// Buffers are written in the same order as they are pushed. If the thread
+/// cannot be started, buffers are written immediately.
+class OFile::AsyncWriter {
+  OFile& file;
+  const unsigned depth;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::string> queue;
+/// True while a buffer is being written
+  bool busy;
+/// True when the thread should terminate
+  bool stop;
+/// True if a write failed
+  bool failed;
+  bool threaded;
+  std::thread thread;
+  void run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while(true) {
+      cv.wait(lock,[this] {return stop || !queue.empty();});
+      if(queue.empty()) return;
+      std::string buf(std::move(queue.front()));
+      queue.pop_front();
+      busy=true;
+      cv.notify_all();
+      lock.unlock();
+      const bool ok=(file.rawwrite(buf.data(),buf.size())==buf.size());
+      lock.lock();
+      if(!ok) failed=true;
+      busy=false;
+      cv.notify_all();
+    }
+  }
+public:
+  AsyncWriter(OFile&file,unsigned depth):
+    file(file),
+    depth(depth),
+    busy(false),
+    stop(false),
+    failed(false),
+    threaded(true)
+  {
+    try {
+      thread=std::thread(&AsyncWriter::run,this);
+    } catch(std::system_error&) {
+      threaded=false;
+    }
+  }
+/// Queue a buffer, waiting if too many buffers are pending. buf is left empty
+  void push(std::string&buf) {
+    if(!threaded) {
+      if(file.rawwrite(buf.data(),buf.size())!=buf.size()) failed=true;
+      buf.clear();
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock,[this] {return queue.size()<depth;});
+    queue.push_back(std::string());
+    queue.back().swap(buf);
+    cv.notify_all();
+  }
+/// Wait until all the buffers have been written.
+/// Returns false if any write failed since the previous call
+  bool wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock,[this] {return queue.empty() && !busy;});
+    const bool ok=!failed;
+    failed=false;
+    return ok;
+  }
+  ~AsyncWriter() {
+    if(threaded) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop=true;
+      }
+      cv.notify_all();
+      thread.join();
+    }
+  }
+};
+
+size_t OFile::rawwrite(const char*ptr,size_t s) {
+  size_t r=0;
+  if(gzfp) {
+#ifdef __PLUMED_HAS_ZLIB
+    r=gzwrite(gzFile(gzfp),ptr,s);
+#else
+    plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
+#endif
+  } else {
+    r=fwrite(ptr,1,s,fp);
+  }
+  return r;
+}
+
+void OFile::pushAsync() {
+  if(asyncBuffer.empty()) return;
+  if(!asyncWriter) asyncWriter.reset(new AsyncWriter(*this,asyncDepth));
+  asyncWriter->push(asyncBuffer);
+}
+
+void OFile::waitAsync() {
+  if(linked || asyncDepth==0) return;
+  int ok=1;
+  if(!(comm && comm->Get_rank()>0)) {
+    pushAsync();
+    if(asyncWriter && !asyncWriter->wait()) ok=0;
+  }
+// the error is raised on all the processes, which would otherwise wait in the next collective call
+  if(comm) comm->Bcast(ok,0);
+  if(!ok) plumed_merror("error writing file " + getPath());
+}
+
 size_t OFile::llwrite(const char*ptr,size_t s) {
   size_t r;
   if(linked) return linked->llwrite(ptr,s);
+// heavily flushed files (e.g. HILLS, read by other walkers) are always written synchronously
+  if(asyncDepth>0 && heavyFlush) setAsync(0);
+  if(asyncDepth>0) {
+// data is collected and written in large chunks by the background writer.
+// no communication is needed since the result of the write is not checked here
+    if(! (comm && comm->Get_rank()>0)) {
+      if(!fp) plumed_merror("writing on uninitilized File");
+      asyncBuffer.append(ptr,s);
+      if(asyncBuffer.size()>=asyncChunkSize) pushAsync();
+    }
+    return s;
+  }
   if(! (comm && comm->Get_rank()>0)) {
     if(!fp) plumed_merror("writing on uninitilized File");
-    if(gzfp) {
-#ifdef __PLUMED_HAS_ZLIB
-      r=gzwrite(gzFile(gzfp),ptr,s);
-#else
-      plumed_merror("file " + getPath() + ": trying to use a gz file without zlib being linked");
-#endif
-    } else {
-      r=fwrite(ptr,1,s,fp);
-    }
+    r=rawwrite(ptr,s);
   }
 //  This barrier is apparently useless since it comes
 //  just before a Bcast.
@@ -73,6 +200,8 @@ size_t OFile::llwrite(const char*ptr,size_t s) {
 
 OFile::OFile():
   linked(NULL),
+  asyncDepth(0),
+  asyncEnforced_(false),
   fieldChanged(false),
   backstring("bck"),
   enforceRestart_(false),
@@ -89,6 +218,15 @@ OFile::OFile():
   for(unsigned i=0; i<1000; ++i) buffer_string[i]=0;
 }
 
+OFile::~OFile() {
+// pending data should be written before the file is closed in the FileBase destructor.
+// errors cannot be reported here
+  if(asyncDepth>0 && !linked && !(comm && comm->Get_rank()>0)) {
+    pushAsync();
+    if(asyncWriter) asyncWriter->wait();
+  }
+}
+
 OFile& OFile::link(OFile&l) {
   fp=NULL;
   gzfp=NULL;
@@ -102,6 +240,8 @@ OFile& OFile::setLinePrefix(const std::string&l) {
 }
 
 int OFile::printf(const char*fmt,...) {
+  std::unique_lock<std::recursive_mutex> lock;
+  if(writeMutex) lock=std::unique_lock<std::recursive_mutex>(*writeMutex);
   va_list arg;
   va_start(arg, fmt);
   int r=std::vsnprintf(&buffer[actual_buffer_length],buflen-actual_buffer_length,fmt,arg);
@@ -314,6 +454,12 @@ OFile& OFile::open(const std::string&path) {
 #endif
     }
   }
+  if(!asyncEnforced_ && !heavyFlush && action && std::getenv("PLUMED_ASYNC_OUTPUT")) {
+    std::string s(std::getenv("PLUMED_ASYNC_OUTPUT"));
+    if(s=="yes") asyncDepth=16;
+    else if(s=="no") asyncDepth=0;
+    else if(!Tools::convert(s,asyncDepth)) plumed_merror("PLUMED_ASYNC_OUTPUT variable is set to " + s + "; should be yes, no or the maximum number of pending buffers");
+  }
   if(plumed) plumed->insertFile(*this);
   return *this;
 }
@@ -324,6 +470,7 @@ OFile& OFile::rewind() {
 // moreover, we can take a backup of the file
   plumed_assert(fp);
   clearFields();
+  waitAsync();
   if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
     gzclose((gzFile)gzfp);
@@ -347,6 +494,7 @@ OFile& OFile::rewind() {
 }
 
 FileBase& OFile::flush() {
+  waitAsync();
   if(heavyFlush) {
     if(gzfp) {
 #ifdef __PLUMED_HAS_ZLIB
@@ -389,5 +537,23 @@ OFile& OFile::enforceBackup() {
   return *this;
 }
 
+OFile& OFile::setAsync(unsigned depth) {
+  waitAsync();
+  asyncDepth=depth;
+  asyncEnforced_=true;
+  return *this;
+}
+
+OFile& OFile::setThreadSafe() {
+  if(!writeMutex) writeMutex.reset(new std::recursive_mutex);
+  return *this;
+}
+
+void OFile::close() {
+  waitAsync();
+  asyncWriter.reset();
+  FileBase::close();
+}
+
 
 }
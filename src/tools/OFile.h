@@ -26,6 +26,7 @@
 #include <vector>
 #include <sstream>
 #include <memory>
+#include <mutex>
 
 namespace PLMD {
 
@@ -79,6 +80,8 @@ keyword. Thus, everytime it is modified, all the headers are repeated in the out
 - printField() without arguments is used as a "newline".
 - most methods return a reference to the OFile itself, to allow chaining many calls on the same line
 (this is similar to << operator in std::ostream)
+- with setAsync() data is collected in large buffers and written by a background thread.
+Data is written in order and is guaranteed to be on disk only after flush(), rewind() or close().
 
 \section using-correctly-ofile Using correctly OFile in PLUMED
 
@@ -164,6 +167,21 @@ class OFile:
   };
 /// Low-level write
   size_t llwrite(const char*,size_t);
+/// Write directly on fp or gzfp
+  size_t rawwrite(const char*,size_t);
+/// Background writer used in asynchronous mode
+  class AsyncWriter;
+  std::unique_ptr<AsyncWriter> asyncWriter;
+/// Maximum number of buffers waiting to be written in asynchronous mode, zero if synchronous
+  unsigned asyncDepth;
+/// True if asynchronous mode was set explicitly with setAsync()
+  bool asyncEnforced_;
+/// Data collected before being passed to the background writer
+  std::string asyncBuffer;
+/// Pass the collected data to the background writer
+  void pushAsync();
+/// Wait for the background writer to complete all the pending writes
+  void waitAsync();
 /// True if fields has changed.
 /// This could be due to a change in the list of fields or a reset
 /// of a nominally constant field
@@ -180,6 +198,8 @@ class OFile:
   std::string linePrefix;
 /// Temporary ostringstream for << output
   std::ostringstream oss;
+/// Serializes printf() and << output, only allocated by setThreadSafe()
+  std::unique_ptr<std::recursive_mutex> writeMutex;
 /// The string used for backing up files
   std::string backstring;
 /// Find field index given name
@@ -193,6 +213,8 @@ class OFile:
 public:
 /// Constructor
   OFile();
+/// Destructor, waits for pending asynchronous writes
+  ~OFile();
 /// Allows overloading of link
   using FileBase::link;
 /// Allows overloading of open
@@ -261,11 +283,23 @@ public:
   OFile&enforceRestart();
 /// Enforce backup, even if the attached plumed object is restarting.
   OFile&enforceBackup();
+/// Write asynchronously, with at most depth buffers waiting to be written.
+/// With depth=0 writes are synchronous. By default, files linked to an Action are written
+/// asynchronously if the PLUMED_ASYNC_OUTPUT environment variable is set.
+/// Files with heavy flush (see FileBase::setHeavyFlush()) are always written synchronously.
+  OFile&setAsync(unsigned depth);
+/// Allow printf() and << output from several threads at the same time.
+/// Each call is written as a whole, but the order of calls from different threads is undefined.
+  OFile&setThreadSafe();
+/// Closes the file, after completing pending asynchronous writes
+  void close();
 };
 
 /// Write using << syntax
 template <class T>
 OFile& operator<<(OFile&of,const T &t) {
+  std::unique_lock<std::recursive_mutex> lock;
+  if(of.writeMutex) lock=std::unique_lock<std::recursive_mutex>(*of.writeMutex);
   of.oss<<t;
   of.printf("%s",of.oss.str().c_str());
   of.oss.str("");
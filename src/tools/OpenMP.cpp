@@ -35,12 +35,28 @@ unsigned OpenMP::getCachelineSize() {
   return cachelineSize;
 }
 
+/// Thread-specific override of the number of threads, zero if not set
+static thread_local unsigned threadBudget=0;
+
 unsigned OpenMP::getNumThreads() {
+  if(threadBudget>0) return threadBudget;
   static unsigned numThreads=1;
   if(std::getenv("PLUMED_NUM_THREADS")) Tools::convert(std::getenv("PLUMED_NUM_THREADS"),numThreads);
   return numThreads;
 }
 
+void OpenMP::setThreadBudget(unsigned n) {
+  threadBudget=n;
+}
+
+void OpenMP::setMaxActiveLevels(unsigned n) {
+#if defined(_OPENMP)
+  if(omp_get_max_active_levels()<static_cast<int>(n)) omp_set_max_active_levels(n);
+#else
+  (void) n;
+#endif
+}
+
 unsigned OpenMP::getThreadNum() {
 #if defined(_OPENMP)
   return omp_get_thread_num();
@@ -49,6 +65,14 @@ unsigned OpenMP::getThreadNum() {
 #endif
 }
 
+unsigned OpenMP::getTeamSize() {
+#if defined(_OPENMP)
+  return omp_get_num_threads();
+#else
+  return 1;
+#endif
+}
+
 
 
 }
@@ -33,9 +33,20 @@ public:
 /// Get number of threads that can be used by openMP
   static unsigned getNumThreads();
 
+/// Set the number of threads that can be used by openMP in regions
+/// started from the calling thread, overriding PLUMED_NUM_THREADS.
+/// Zero restores the default. Used when actions are calculated concurrently.
+  static void setThreadBudget(unsigned);
+
+/// Allow nested parallel regions up to the given depth
+  static void setMaxActiveLevels(unsigned);
+
 /// Returns a unique thread identification number within the current team
   static unsigned getThreadNum();
 
+/// Returns the number of threads in the current team
+  static unsigned getTeamSize();
+
 /// get cacheline size
   static unsigned getCachelineSize();
 
@@ -356,6 +356,31 @@ double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
   }
 }
 
+float SwitchingFunction::calculateSqr(float distance2,float&dfunc)const {
+// with M=2N the rational function is 1/(1+x^N), which is numerically stable
+// in single precision also close to r_0
+  if(type==rational && nn%2==0 && mm==2*nn && d0==0.0) {
+    if(distance2>dmax_2) {
+      dfunc=0.0f;
+      return 0.0f;
+    }
+    const float invr0_2f=invr0_2;
+    const float stretchf=stretch;
+    const int n=nn/2;
+    const float rdist_2 = distance2*invr0_2f;
+    const float rNdist=Tools::fastpow(rdist_2,n-1);
+    const float iden=1.0f/(1.0f+rNdist*rdist_2);
+// chain rule and stretch:
+    dfunc = -n*rNdist*iden*iden*2.0f*invr0_2f*stretchf;
+    return iden*stretchf+static_cast<float>(shift);
+  } else {
+    double ddfunc=0.0;
+    double result=calculateSqr(static_cast<double>(distance2),ddfunc);
+    dfunc=ddfunc;
+    return result;
+  }
+}
+
 double SwitchingFunction::calculate(double distance,double&dfunc)const {
   plumed_massert(init,"you are trying to use an unset SwitchingFunction");
   if(distance>dmax) {
@@ -104,6 +104,11 @@ public:
 /// The advantage is that in some case the expensive square root can be avoided
 /// (namely for rational functions, if nn and mm are even and d0 is zero)
   double calculateSqr(double distance2,double&dfunc)const;
+/// Single precision version of calculateSqr().
+/// Only rational functions with even exponents, M=2N and d0 equal to zero are
+/// actually evaluated in single precision; the other cases are computed in
+/// double precision and converted.
+  float calculateSqr(float distance2,float&dfunc)const;
 /// Returns d0
   double get_d0() const;
 /// Returns r0
@@ -24,9 +24,11 @@
 #include "Exception.h"
 #include "IFile.h"
 #include "lepton/Lepton.h"
+#include <cfloat>
 #include <cstring>
 #include <dirent.h>
 #include <iostream>
+#include <limits>
 #include <map>
 
 using namespace std;
@@ -48,6 +50,101 @@ static std::map<string, double> leptonConstants= {
   {"sqrt1_2", std::sqrt(0.5)}
 };
 
+/// Parse a plain integer (an optional sign followed by decimal digits)
+/// without constructing a stream. Returns false whenever the string is
+/// not in this simple form or does not fit into T, so that the caller
+/// can fall back to the generic parser and keep its exact behavior.
+template<class T>
+static bool fastConvertInteger(const string & str,T & t) {
+  const char* p=str.c_str();
+  bool neg=false;
+  if(*p=='+' || *p=='-') { neg=(*p=='-'); p++; }
+// unsigned streams accept negative numbers and wrap them around
+  if(neg && !std::numeric_limits<T>::is_signed) return false;
+  if(*p<'0' || *p>'9') return false;
+  unsigned long long v=0;
+  unsigned ndigits=0;
+  for(; *p>='0' && *p<='9'; p++) {
+    if(++ndigits>18) return false;
+    v=10*v+(*p-'0');
+  }
+  if(*p) return false;
+  if(neg) {
+    if(v>static_cast<unsigned long long>(std::numeric_limits<T>::max())+1) return false;
+    t=static_cast<T>(-static_cast<long long>(v));
+  } else {
+    if(v>static_cast<unsigned long long>(std::numeric_limits<T>::max())) return false;
+    t=static_cast<T>(v);
+  }
+  return true;
+}
+
+/// Parse a plain decimal real number (e.g. -1.25e-3) without constructing
+/// a stream. Only the cases where the result is exactly the correctly
+/// rounded one are handled here, that is when both the decimal mantissa and
+/// the power of ten are exactly representable in T, so that a single
+/// multiplication or division is performed (Clinger's fast path).
+/// In all other cases false is returned and the generic parser is used.
+template<class T>
+static bool fastConvertReal(const string & str,T & t) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD!=0
+  return false;
+#endif
+  if(!std::numeric_limits<T>::is_iec559) return false;
+  int maxexp;
+  unsigned long long maxm;
+  if(std::numeric_limits<T>::digits==53) {maxexp=22; maxm=1ULL<<53;}
+  else if(std::numeric_limits<T>::digits==24) {maxexp=10; maxm=1ULL<<24;}
+  else return false;
+  static const double powers[]= {
+    1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+  };
+  const char* p=str.c_str();
+  bool neg=false;
+  if(*p=='+' || *p=='-') { neg=(*p=='-'); p++; }
+  unsigned long long m=0;
+  unsigned ndigits=0;
+  int exp10=0;
+  bool anydigit=false;
+  for(; *p>='0' && *p<='9'; p++) {
+    anydigit=true;
+    if(m==0 && *p=='0') continue;
+    if(++ndigits>19) return false;
+    m=10*m+(*p-'0');
+  }
+  if(*p=='.') {
+    p++;
+    for(; *p>='0' && *p<='9'; p++) {
+      anydigit=true;
+      exp10--;
+      if(m==0 && *p=='0') continue;
+      if(++ndigits>19) return false;
+      m=10*m+(*p-'0');
+    }
+  }
+  if(!anydigit) return false;
+  if(*p=='e' || *p=='E') {
+    p++;
+    bool eneg=false;
+    if(*p=='+' || *p=='-') { eneg=(*p=='-'); p++; }
+    if(*p<'0' || *p>'9') return false;
+    int e=0;
+    for(; *p>='0' && *p<='9'; p++) if(e<100000) e=10*e+(*p-'0');
+    exp10+=(eneg?-e:e);
+  }
+  if(*p) return false;
+  if(m>maxm) return false;
+  T v=static_cast<T>(m);
+  if(m!=0) {
+    if(exp10<-maxexp || exp10>maxexp) return false;
+    if(exp10<0) v/=static_cast<T>(powers[-exp10]);
+    else v*=static_cast<T>(powers[exp10]);
+  }
+  t=(neg?-v:v);
+  return true;
+}
+
 template<class T>
 bool Tools::convertToAny(const string & str,T & t) {
   istringstream istr(str.c_str());
@@ -59,14 +156,17 @@ bool Tools::convertToAny(const string & str,T & t) {
 }
 
 bool Tools::convert(const string & str,int & t) {
+  if(fastConvertInteger(str,t)) return true;
   return convertToAny(str,t);
 }
 
 bool Tools::convert(const string & str,long int & t) {
+  if(fastConvertInteger(str,t)) return true;
   return convertToAny(str,t);
 }
 
 bool Tools::convert(const string & str,unsigned & t) {
+  if(fastConvertInteger(str,t)) return true;
   return convertToAny(str,t);
 }
 
@@ -79,6 +179,7 @@ bool Tools::convert(const string & str,AtomNumber &a) {
 
 template<class T>
 bool Tools::convertToReal(const string & str,T & t) {
+  if(fastConvertReal(str,t)) return true;
   if(convertToAny(str,t)) return true;
   if(str=="PI" || str=="+PI" || str=="+pi" || str=="pi") {
     t=pi; return true;
@@ -132,6 +132,8 @@ public:
   static std::string extension(const std::string&);
 /// Fast int power
   static double fastpow(double base,int exp);
+/// Fast int power, single precision version
+  static float fastpow(float base,int exp);
 /// Modified 0th-order Bessel function of the first kind
   static double bessel0(const double& val);
 /// Check if a string full starts with string start.
@@ -233,6 +235,25 @@ double Tools::fastpow(double base, int exp)
   return result;
 }
 
+inline
+float Tools::fastpow(float base, int exp)
+{
+  if(exp<0) {
+    exp=-exp;
+    base=1.0f/base;
+  }
+  float result = 1.0f;
+  while (exp)
+  {
+    if (exp & 1)
+      result *= base;
+    exp >>= 1;
+    base *= base;
+  }
+
+  return result;
+}
+
 }
 
 #endif
@@ -124,7 +124,7 @@ void COM::calculate() {
     }
     first=false;
   }
-  vector<Tensor> deriv(getNumberOfAtoms());
+  vector<double> deriv(getNumberOfAtoms());
   for(unsigned i=0; i<getNumberOfAtoms(); i++) mass+=getMass(i);
   if( plumed.getAtoms().chargesWereSet() ) {
     double charge(0.0);
@@ -135,7 +135,7 @@ void COM::calculate() {
   }
   for(unsigned i=0; i<getNumberOfAtoms(); i++) {
     pos+=(getMass(i)/mass)*getPosition(i);
-    deriv[i]=(getMass(i)/mass)*Tensor::identity();
+    deriv[i]=getMass(i)/mass;
   }
   setPosition(pos);
   setMass(mass);
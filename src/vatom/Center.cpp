@@ -143,7 +143,7 @@ void Center::calculate() {
   Vector pos;
   double mass(0.0);
   if(!nopbc) makeWhole();
-  vector<Tensor> deriv(getNumberOfAtoms());
+  vector<double> deriv(getNumberOfAtoms());
   for(unsigned i=0; i<getNumberOfAtoms(); i++) mass+=getMass(i);
   if( plumed.getAtoms().chargesWereSet() ) {
     double charge(0.0);
@@ -159,7 +159,7 @@ void Center::calculate() {
     if(weight_mass) w=getMass(i)/mass;
     else w=weights[i]/wtot;
     pos+=w*getPosition(i);
-    deriv[i]=w*Tensor::identity();
+    deriv[i]=w;
   }
   setPosition(pos);
   setMass(mass);
@@ -92,7 +92,7 @@ class BF_Chebyshev : public BasisFunctions {
 public:
   static void registerKeywords(Keywords&);
   explicit BF_Chebyshev(const ActionOptions&);
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -118,7 +118,7 @@ BF_Chebyshev::BF_Chebyshev(const ActionOptions&ao):
 }
 
 
-void BF_Chebyshev::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Chebyshev::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   // plumed_assert(values.size()==numberOfBasisFunctions());
   // plumed_assert(derivs.size()==numberOfBasisFunctions());
   inside_range=true;
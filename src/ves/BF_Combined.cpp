@@ -70,7 +70,7 @@ class BF_Combined : public BasisFunctions {
 public:
   static void registerKeywords(Keywords&);
   explicit BF_Combined(const ActionOptions&);
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -147,7 +147,7 @@ BF_Combined::BF_Combined(const ActionOptions&ao):
 // }
 
 
-void BF_Combined::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Combined::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   // first BF, constant, argT, and inside_range taken from here
   unsigned int r=0;
   std::vector<double> values_tmp(basisf_pntrs_[0]->numberOfBasisFunctions(),0.0);
@@ -87,7 +87,7 @@ class BF_Cosine : public BasisFunctions {
 public:
   static void registerKeywords(Keywords&);
   explicit BF_Cosine(const ActionOptions&);
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -113,7 +113,7 @@ BF_Cosine::BF_Cosine(const ActionOptions&ao):
 }
 
 
-void BF_Cosine::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Cosine::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   // plumed_assert(values.size()==numberOfBasisFunctions());
   // plumed_assert(derivs.size()==numberOfBasisFunctions());
   inside_range=true;
@@ -133,7 +133,7 @@ public:
   static void registerKeywords( Keywords&);
   explicit BF_Custom(const ActionOptions&);
   ~BF_Custom() {};
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 PLUMED_REGISTER_ACTION(BF_Custom,"BF_CUSTOM")
@@ -301,7 +301,7 @@ BF_Custom::BF_Custom(const ActionOptions&ao):
 }
 
 
-void BF_Custom::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Custom::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   inside_range=true;
   argT=checkIfArgumentInsideInterval(arg,inside_range);
   double transf_derivf=1.0;
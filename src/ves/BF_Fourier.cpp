@@ -88,7 +88,7 @@ class BF_Fourier : public BasisFunctions {
 public:
   static void registerKeywords(Keywords&);
   explicit BF_Fourier(const ActionOptions&);
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -114,7 +114,7 @@ BF_Fourier::BF_Fourier(const ActionOptions&ao):
 }
 
 
-void BF_Fourier::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Fourier::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   // plumed_assert(values.size()==numberOfBasisFunctions());
   // plumed_assert(derivs.size()==numberOfBasisFunctions());
   inside_range=true;
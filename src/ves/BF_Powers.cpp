@@ -84,7 +84,7 @@ public:
   static void registerKeywords( Keywords&);
   explicit BF_Powers(const ActionOptions&);
   double getValue(const double, const unsigned int, double&, bool&) const;
-  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -116,7 +116,7 @@ BF_Powers::BF_Powers(const ActionOptions&ao):
 }
 
 
-void BF_Powers::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+void BF_Powers::calculateAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   inside_range=true;
   argT=checkIfArgumentInsideInterval(arg,inside_range);
   //
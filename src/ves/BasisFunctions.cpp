@@ -29,6 +29,9 @@
 #include "tools/Grid.h"
 #include "tools/Tools.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace PLMD {
 namespace ves {
@@ -41,6 +44,8 @@ void BasisFunctions::registerKeywords(Keywords& keys) {
   keys.add("hidden","NGRID_POINTS","The number of grid points used for numerical integrals");
   keys.addFlag("DEBUG_INFO",false,"Print out more detailed information about the basis set. Useful for debugging.");
   keys.addFlag("NUMERICAL_INTEGRALS",false,"Calculate basis function integral for the uniform distribution numerically. Useful for debugging.");
+  keys.addFlag("TABULATE",false,"Interpolate the values and derivatives of the basis functions from tables that are calculated at the beginning of the simulation. This makes the cost of evaluating the basis functions independent of their type, which is useful for BF_CUSTOM and for basis sets of high order.");
+  keys.add("optional","TABULATION_TOLERANCE","The largest error allowed for the interpolation of the basis functions when using TABULATE, relative to the largest absolute value of each basis function or of its derivative if it is larger than one. By default it is 1e-8.");
 }
 
 
@@ -72,6 +77,11 @@ BasisFunctions::BasisFunctions(const ActionOptions&ao):
   numerical_uniform_integrals_(false),
   nbins_(1001),
   uniform_integrals_(nbasis_,0.0),
+  tabulated_(false),
+  tabulation_tolerance_(0.0),
+  tabulation_nbins_(0),
+  tabulation_dx_(0.0),
+  tabulation_table_(0),
   vesbias_pntr_(NULL),
   action_pntr_(NULL)
 {
@@ -107,6 +117,16 @@ BasisFunctions::BasisFunctions(const ActionOptions&ao):
   if(keywords.exists("NGRID_POINTS")) {
     parse("NGRID_POINTS",nbins_);
   }
+  if(keywords.exists("TABULATE")) {
+    // the tables are setup in setupBF(), when the basis functions are defined
+    bool tabulate=false;
+    parseFlag("TABULATE",tabulate);
+    if(tabulate) {
+      tabulation_tolerance_=1.0e-8;
+      parse("TABULATION_TOLERANCE",tabulation_tolerance_);
+      if(tabulation_tolerance_<=0.0) {plumed_merror(getName()+": TABULATION_TOLERANCE should be positive");}
+    }
+  }
   // log.printf(" %s \n",getKeywordString().c_str());
 
 }
@@ -190,6 +210,7 @@ void BasisFunctions::setupBF() {
   if(uniform_integrals_.size()==1) {plumed_merror("setupBF: the integrals of the basis functions is not correct.");}
   if(type_=="Undefined") {plumed_merror("setupBF: the type of the basis function is not defined.");}
   if(description_=="Undefined") {plumed_merror("setupBF: the description of the basis function is not defined.");}
+  if(tabulation_tolerance_>0.0) {setupTabulation();}
   has_been_set=true;
   printInfo();
 }
@@ -205,6 +226,9 @@ void BasisFunctions::printInfo() const {
   log.printf("   Number of basis functions: %u\n",nbasis_);
   // log.printf("   Interval of basis set: %f to %f\n",interval_min_,interval_max_);
   log.printf("   Interval of basis set: %s to %s\n",interval_min_str_.c_str(),interval_max_str_.c_str());
+  if(tabulated_) {
+    log.printf("   Values and derivatives interpolated from tables with %u bins (largest relative error %e)\n",tabulation_nbins_,tabulationError());
+  }
   log.printf("   Description of basis functions:\n");
   for(unsigned int i=0; i < nbasis_; i++) {log.printf("    %2u       %10s\n",i,bf_labels_[i].c_str());}
   //
@@ -225,6 +249,135 @@ void BasisFunctions::printInfo() const {
 }
 
 
+void BasisFunctions::setupTabulation() {
+  /*
+  The values and derivatives are interpolated with quintic Hermite splines, the number
+  of bins is doubled until the error inside the bins is below the tolerance.
+  The second derivatives at the nodes are obtained by finite differences of the
+  analytical derivatives, with a step much smaller than the bins.
+  */
+  const unsigned int stride = 3*nbasis_+1;
+  unsigned int nbins = 64;
+  while(true) {
+    tabulation_nbins_ = nbins;
+    tabulation_dx_ = interval_range_/nbins;
+    tabulation_table_.assign((nbins+1)*stride,0.0);
+    std::vector<double> values(nbasis_);
+    std::vector<double> derivs(nbasis_);
+    std::vector<std::vector<double> > derivs_fd(4,std::vector<double>(nbasis_));
+    const double delta = tabulation_dx_/8.0;
+    for(unsigned int k=0; k<=nbins; k++) {
+      double arg = interval_min_+k*tabulation_dx_;
+      if(k==nbins) {arg = interval_max_;}
+      bool inside=true;
+      double argT_fd;
+      double* point = tabulation_table_.data()+k*stride;
+      calculateAllValues(arg,point[0],inside,values,derivs);
+      std::copy(values.begin(),values.end(),point+1);
+      std::copy(derivs.begin(),derivs.end(),point+1+nbasis_);
+      double* second = point+1+2*nbasis_;
+      if(k>0 && k<nbins) {
+        // fourth order central differences
+        const double steps[4] = {-2.0,-1.0,1.0,2.0};
+        for(unsigned int l=0; l<4; l++) {calculateAllValues(arg+steps[l]*delta,argT_fd,inside,values,derivs_fd[l]);}
+        for(unsigned int i=0; i<nbasis_; i++) {
+          second[i] = (derivs_fd[0][i]-8.0*derivs_fd[1][i]+8.0*derivs_fd[2][i]-derivs_fd[3][i])/(12.0*delta);
+        }
+      }
+      else {
+        // fourth order one-sided differences, since the derivatives vanish outside the interval
+        const double sign = (k==0 ? 1.0 : -1.0);
+        for(unsigned int l=0; l<4; l++) {calculateAllValues(arg+sign*(l+1)*delta,argT_fd,inside,values,derivs_fd[l]);}
+        for(unsigned int i=0; i<nbasis_; i++) {
+          second[i] = sign*(-25.0*derivs[i]+48.0*derivs_fd[0][i]-36.0*derivs_fd[1][i]+16.0*derivs_fd[2][i]-3.0*derivs_fd[3][i])/(12.0*delta);
+        }
+      }
+    }
+    if(tabulationError()<tabulation_tolerance_) {break;}
+    if(nbins>=(1u<<16)) {
+      plumed_merror(getName()+" with label "+getLabel()+": cannot reach the TABULATION_TOLERANCE for the interpolation of the basis functions, use a larger value");
+    }
+    nbins *= 2;
+  }
+  tabulated_ = true;
+}
+
+
+double BasisFunctions::tabulationError() const {
+  // largest error inside the bins, relative to the largest absolute value of each function
+  const unsigned int stride = 3*nbasis_+1;
+  std::vector<double> values(nbasis_), derivs(nbasis_);
+  std::vector<double> values_tab(nbasis_), derivs_tab(nbasis_);
+  std::vector<double> values_max(nbasis_,1.0), derivs_max(nbasis_,1.0);
+  for(unsigned int k=0; k<=tabulation_nbins_; k++) {
+    const double* point = tabulation_table_.data()+k*stride;
+    for(unsigned int i=0; i<nbasis_; i++) {
+      values_max[i] = std::max(values_max[i],std::abs(point[1+i]));
+      derivs_max[i] = std::max(derivs_max[i],std::abs(point[1+nbasis_+i]));
+    }
+  }
+  double error = 0.0;
+  // the errors of the values and of the derivatives peak at different
+  // points inside the bins, so several points are checked
+  const double offsets[5] = {0.15,0.3,0.5,0.7,0.85};
+  for(unsigned int k=0; k<tabulation_nbins_; k++) {
+    for(unsigned int l=0; l<5; l++) {
+      double arg = interval_min_+(k+offsets[l])*tabulation_dx_;
+      double argT; bool inside=true;
+      calculateAllValues(arg,argT,inside,values,derivs);
+      getAllValuesFromTable(arg,argT,inside,values_tab,derivs_tab);
+      for(unsigned int i=0; i<nbasis_; i++) {
+        error = std::max(error,std::abs(values_tab[i]-values[i])/values_max[i]);
+        error = std::max(error,std::abs(derivs_tab[i]-derivs[i])/derivs_max[i]);
+      }
+    }
+  }
+  return error;
+}
+
+
+void BasisFunctions::getAllValuesFromTable(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  inside_range=true;
+  double x = (checkIfArgumentInsideInterval(arg,inside_range)-interval_min_)/tabulation_dx_;
+  unsigned int k = static_cast<unsigned int>(x);
+  if(k>=tabulation_nbins_) {k=tabulation_nbins_-1;}
+  double t = x-k;
+  const double dx = tabulation_dx_;
+  // quintic Hermite basis and its derivative
+  double t2 = t*t;
+  double t3 = t2*t;
+  double t4 = t3*t;
+  double t5 = t4*t;
+  double h00 = 1.0-10.0*t3+15.0*t4-6.0*t5;
+  double h10 = (t-6.0*t3+8.0*t4-3.0*t5)*dx;
+  double h20 = 0.5*(t2-3.0*t3+3.0*t4-t5)*dx*dx;
+  double h01 = 10.0*t3-15.0*t4+6.0*t5;
+  double h11 = (-4.0*t3+7.0*t4-3.0*t5)*dx;
+  double h21 = 0.5*(t3-2.0*t4+t5)*dx*dx;
+  double g00 = (-30.0*t2+60.0*t3-30.0*t4)/dx;
+  double g10 = 1.0-18.0*t2+32.0*t3-15.0*t4;
+  double g20 = 0.5*(2.0*t-9.0*t2+12.0*t3-5.0*t4)*dx;
+  double g01 = -g00;
+  double g11 = -12.0*t2+28.0*t3-15.0*t4;
+  double g21 = 0.5*(3.0*t2-8.0*t3+5.0*t4)*dx;
+  const double* p0 = tabulation_table_.data()+k*(3*nbasis_+1);
+  const double* p1 = p0+(3*nbasis_+1);
+  // the translated argument is only used for output, a linear interpolation is enough
+  argT = (1.0-t)*p0[0]+t*p1[0];
+  for(unsigned int i=0; i<nbasis_; i++) {
+    double v0 = p0[1+i];
+    double v1 = p1[1+i];
+    double d0 = p0[1+nbasis_+i];
+    double d1 = p1[1+nbasis_+i];
+    double s0 = p0[1+2*nbasis_+i];
+    double s1 = p1[1+2*nbasis_+i];
+    values[i] = h00*v0+h10*d0+h20*s0+h01*v1+h11*d1+h21*s1;
+    derivs[i] = g00*v0+g10*d0+g20*s0+g01*v1+g11*d1+g21*s1;
+  }
+  if(!inside_range) {for(unsigned int i=0; i<nbasis_; i++) {derivs[i]=0.0;}}
+}
+
+
 void BasisFunctions::linkVesBias(VesBias* vesbias_pntr_in) {
   vesbias_pntr_ = vesbias_pntr_in;
   action_pntr_ = static_cast<Action*>(vesbias_pntr_in);
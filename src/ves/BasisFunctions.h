@@ -93,11 +93,21 @@ private:
   unsigned int nbins_;
   // the integrals of the basis functions over the interval on which they are defined
   std::vector <double> uniform_integrals_;
+  // interpolate the basis functions from tables instead of calculating them
+  bool tabulated_;
+  double tabulation_tolerance_;
+  unsigned int tabulation_nbins_;
+  double tabulation_dx_;
+  // for each point of the table: the translated argument, the values, the first and the second derivatives
+  std::vector<double> tabulation_table_;
   //
   VesBias* vesbias_pntr_;
   Action* action_pntr_;
   //
   void getAllValuesNumericalDerivs(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void setupTabulation();
+  double tabulationError() const;
+  void getAllValuesFromTable(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 
 protected:
   // setup various stuff
@@ -160,6 +170,7 @@ public:
   double intervalDerivf() const {return argT_derivf_;}
   std::string intervalMinStr() const {return interval_min_str_;}
   std::string intervalMaxStr() const {return interval_max_str_;}
+  bool isTabulated() const {return tabulated_;}
   std::vector<double> getUniformIntegrals() const {return uniform_integrals_;}
   std::vector<double> getTargetDistributionIntegrals(const TargetDistribution*) const;
   //
@@ -182,7 +193,9 @@ public:
   // calculate the value for the n-th basis function
   double getValue(const double, const unsigned int, double&, bool&) const;
   // calcuate the values for all basis functions
-  virtual void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const = 0;
+  void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  // calculate the values for all basis functions without using the tables, implemented by each basis set
+  virtual void calculateAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const = 0;
   //virtual void get2ndDerivaties(const double, std::vector<double>&)=0;
   void printInfo() const;
   //
@@ -199,6 +212,13 @@ void BasisFunctions::setNumberOfBasisFunctions(const unsigned int nbasis_in) {
 }
 
 
+inline
+void BasisFunctions::getAllValues(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  if(tabulated_) {getAllValuesFromTable(arg,argT,inside_range,values,derivs);}
+  else {calculateAllValues(arg,argT,inside_range,values,derivs);}
+}
+
+
 inline
 VesBias* BasisFunctions::getPntrToVesBias() const {
   plumed_massert(vesbias_pntr_!=NULL,"the VES bias has not been linked");
@@ -32,6 +32,7 @@
 #include "tools/Keywords.h"
 #include "tools/Grid.h"
 #include "tools/Communicator.h"
+#include "tools/OpenMP.h"
 
 #include "GridProjWeights.h"
 
@@ -75,7 +76,13 @@ LinearBasisSetExpansion::LinearBasisSetExpansion(
   fes_grid_pntr_(NULL),
   log_targetdist_grid_pntr_(NULL),
   targetdist_grid_pntr_(NULL),
-  targetdist_pntr_(NULL)
+  targetdist_pntr_(NULL),
+  grid_cache_nbins_(0),
+  grid_cache_min_(0),
+  grid_cache_dx_(0),
+  grid_bf_values_(0),
+  grid_bf_derivs_(0),
+  coeffs_indices_(0)
 {
   plumed_massert(args_pntrs_.size()==basisf_pntrs_.size(),"number of arguments and basis functions do not match");
   for(unsigned int k=0; k<nargs_; k++) {nbasisf_[k]=basisf_pntrs_[k]->getNumberOfBasisFunctions();}
@@ -191,11 +198,11 @@ void LinearBasisSetExpansion::updateBiasGrid() {
   if(action_pntr_!=NULL &&  getStepOfLastBiasGridUpdate()==action_pntr_->getStep()) {
     return;
   }
+  std::vector<double> values;
+  calculateBiasAndForcesOnGrid(bias_grid_pntr_,values);
   for(Grid::index_t l=0; l<bias_grid_pntr_->getSize(); l++) {
-    std::vector<double> forces(nargs_);
-    std::vector<double> args = bias_grid_pntr_->getPoint(l);
-    bool all_inside=true;
-    double bias=getBiasAndForces(args,all_inside,forces);
+    double bias = values[l*(nargs_+1)];
+    std::vector<double> forces(values.begin()+l*(nargs_+1)+1,values.begin()+(l+1)*(nargs_+1));
     //
     if(biasCutoffActive()) {
       vesbias_pntr_->applyBiasCutoff(bias,forces);
@@ -226,11 +233,11 @@ void LinearBasisSetExpansion::updateBiasWithoutCutoffGrid() {
     return;
   }
   //
+  std::vector<double> values;
+  calculateBiasAndForcesOnGrid(bias_withoutcutoff_grid_pntr_,values);
   for(Grid::index_t l=0; l<bias_withoutcutoff_grid_pntr_->getSize(); l++) {
-    std::vector<double> forces(nargs_);
-    std::vector<double> args = bias_withoutcutoff_grid_pntr_->getPoint(l);
-    bool all_inside=true;
-    double bias=getBiasAndForces(args,all_inside,forces);
+    double bias = values[l*(nargs_+1)];
+    std::vector<double> forces(values.begin()+l*(nargs_+1)+1,values.begin()+(l+1)*(nargs_+1));
     if(bias_withoutcutoff_grid_pntr_->hasDerivatives()) {
       bias_withoutcutoff_grid_pntr_->setValueAndDerivatives(l,bias,forces);
     }
@@ -568,22 +575,137 @@ void LinearBasisSetExpansion::restartTargetDistribution() {
 }
 
 
+void LinearBasisSetExpansion::setupGridCache(const Grid* grid_pntr) {
+  // the grid points are identified by the first point, the spacing and the number of bins
+  std::vector<double> grid_min = grid_pntr->getPoint(std::vector<unsigned>(nargs_,0));
+  if(grid_cache_nbins_==grid_pntr->getNbin() && grid_cache_min_==grid_min && grid_cache_dx_==grid_pntr->getDx()) {
+    return;
+  }
+  grid_cache_nbins_ = grid_pntr->getNbin();
+  grid_cache_min_ = grid_min;
+  grid_cache_dx_ = grid_pntr->getDx();
+  grid_bf_values_.assign(nargs_,std::vector<double>(0));
+  grid_bf_derivs_.assign(nargs_,std::vector<double>(0));
+  for(unsigned int k=0; k<nargs_; k++) {
+    grid_bf_values_[k].assign(grid_cache_nbins_[k]*nbasisf_[k],0.0);
+    grid_bf_derivs_[k].assign(grid_cache_nbins_[k]*nbasisf_[k],0.0);
+    std::vector<unsigned> indices(nargs_,0);
+    std::vector<double> tmp_val(nbasisf_[k]);
+    std::vector<double> tmp_der(nbasisf_[k]);
+    for(unsigned int j=0; j<grid_cache_nbins_[k]; j++) {
+      indices[k] = j;
+      std::vector<double> args = grid_pntr->getPoint(indices);
+      double arg_trsfrm;
+      bool inside=true;
+      basisf_pntrs_[k]->getAllValues(args[k],arg_trsfrm,inside,tmp_val,tmp_der);
+      std::copy(tmp_val.begin(),tmp_val.end(),grid_bf_values_[k].begin()+j*nbasisf_[k]);
+      std::copy(tmp_der.begin(),tmp_der.end(),grid_bf_derivs_[k].begin()+j*nbasisf_[k]);
+    }
+  }
+  if(coeffs_indices_.size()!=ncoeffs_*nargs_) {
+    coeffs_indices_.resize(ncoeffs_*nargs_);
+    for(size_t i=0; i<ncoeffs_; i++) {
+      std::vector<unsigned int> indices=bias_coeffs_pntr_->getIndices(i);
+      std::copy(indices.begin(),indices.end(),coeffs_indices_.begin()+i*nargs_);
+    }
+  }
+}
+
+
+void LinearBasisSetExpansion::getGridPointIndices(size_t index, std::vector<unsigned>& indices) const {
+  for(unsigned int k=0; k<nargs_; k++) {
+    indices[k] = index%grid_cache_nbins_[k];
+    index /= grid_cache_nbins_[k];
+  }
+}
+
+
+void LinearBasisSetExpansion::calculateBiasAndForcesOnGrid(const Grid* grid_pntr, std::vector<double>& values) {
+  // same as getBiasAndForces() but using the basis functions cached on the grid,
+  // the bias and the forces at each grid point are stored consecutively in values
+  setupGridCache(grid_pntr);
+  size_t npoints = grid_pntr->getSize();
+  values.assign(npoints*(nargs_+1),0.0);
+  size_t stride=1;
+  size_t rank=0;
+  if(!serial_) {
+    stride=mycomm_.Get_size();
+    rank=mycomm_.Get_rank();
+  }
+  const std::vector<double>& coeffs = bias_coeffs_pntr_->getDataAsVector();
+  #pragma omp parallel num_threads(OpenMP::getNumThreads())
+  {
+    std::vector<unsigned> point_indices(nargs_);
+    std::vector<const double*> bf_values(nargs_);
+    std::vector<const double*> bf_derivs(nargs_);
+    #pragma omp for
+    for(size_t l=rank; l<npoints; l+=stride) {
+      getGridPointIndices(l,point_indices);
+      for(unsigned int k=0; k<nargs_; k++) {
+        bf_values[k] = grid_bf_values_[k].data()+point_indices[k]*nbasisf_[k];
+        bf_derivs[k] = grid_bf_derivs_[k].data()+point_indices[k]*nbasisf_[k];
+      }
+      double bias=0.0;
+      double* forces = values.data()+l*(nargs_+1)+1;
+      for(size_t i=0; i<ncoeffs_; i++) {
+        const unsigned int* indices = coeffs_indices_.data()+i*nargs_;
+        double coeff = coeffs[i];
+        double bf_curr=1.0;
+        for(unsigned int k=0; k<nargs_; k++) {
+          bf_curr*=bf_values[k][indices[k]];
+        }
+        bias+=coeff*bf_curr;
+        for(unsigned int k=0; k<nargs_; k++) {
+          double der = 1.0;
+          for(unsigned int m=0; m<nargs_; m++) {
+            if(m!=k) {der*=bf_values[m][indices[m]];}
+            else {der*=bf_derivs[m][indices[m]];}
+          }
+          forces[k]-=coeff*der;
+        }
+      }
+      values[l*(nargs_+1)] = bias;
+    }
+  }
+  if(stride>1) {mycomm_.Sum(values);}
+}
+
+
 void LinearBasisSetExpansion::calculateTargetDistAveragesFromGrid(const Grid* targetdist_grid_pntr) {
   plumed_assert(targetdist_grid_pntr!=NULL);
+  setupGridCache(targetdist_grid_pntr);
   std::vector<double> targetdist_averages(ncoeffs_,0.0);
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(targetdist_grid_pntr);
   Grid::index_t stride=mycomm_.Get_size();
   Grid::index_t rank=mycomm_.Get_rank();
-  for(Grid::index_t l=rank; l<targetdist_grid_pntr->getSize(); l+=stride) {
-    std::vector<double> args_values = targetdist_grid_pntr->getPoint(l);
-    std::vector<double> basisset_values(ncoeffs_);
-    // parallelization done over the grid -> should NOT use parallel in getBasisSetValues!!
-    getBasisSetValues(args_values,basisset_values,false);
-    double weight = integration_weights[l]*targetdist_grid_pntr->getValue(l);
-    for(unsigned int i=0; i<ncoeffs_; i++) {
-      targetdist_averages[i] += weight*basisset_values[i];
+  // the partial sums of each thread are added in thread order so that the result is reproducible
+  unsigned int nt=OpenMP::getNumThreads();
+  std::vector< std::vector<double> > omp_averages(nt,std::vector<double>(ncoeffs_,0.0));
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double>& averages = omp_averages[OpenMP::getThreadNum()];
+    std::vector<unsigned> point_indices(nargs_);
+    std::vector<const double*> bf_values(nargs_);
+    #pragma omp for schedule(static)
+    for(Grid::index_t l=rank; l<targetdist_grid_pntr->getSize(); l+=stride) {
+      getGridPointIndices(l,point_indices);
+      for(unsigned int k=0; k<nargs_; k++) {
+        bf_values[k] = grid_bf_values_[k].data()+point_indices[k]*nbasisf_[k];
+      }
+      double weight = integration_weights[l]*targetdist_grid_pntr->getValue(l);
+      for(size_t i=0; i<ncoeffs_; i++) {
+        const unsigned int* indices = coeffs_indices_.data()+i*nargs_;
+        double bf_curr=1.0;
+        for(unsigned int k=0; k<nargs_; k++) {
+          bf_curr*=bf_values[k][indices[k]];
+        }
+        averages[i] += weight*bf_curr;
+      }
     }
   }
+  for(unsigned int t=0; t<nt; t++) {
+    for(size_t i=0; i<ncoeffs_; i++) {targetdist_averages[i]+=omp_averages[t][i];}
+  }
   mycomm_.Sum(targetdist_averages);
   // the overall constant;
   targetdist_averages[0] = getBasisSetConstant();
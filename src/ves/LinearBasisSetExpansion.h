@@ -83,6 +83,14 @@ private:
   Grid* targetdist_grid_pntr_;
   //
   TargetDistribution* targetdist_pntr_;
+  // values and derivatives of the basis functions on the points of the grids
+  // along each argument, they do not change so they are only calculated once
+  std::vector<unsigned> grid_cache_nbins_;
+  std::vector<double> grid_cache_min_;
+  std::vector<double> grid_cache_dx_;
+  std::vector< std::vector<double> > grid_bf_values_;
+  std::vector< std::vector<double> > grid_bf_derivs_;
+  std::vector<unsigned int> coeffs_indices_;
 public:
   static void registerKeywords( Keywords& keys );
   // Constructor
@@ -185,6 +193,9 @@ private:
   //
   Grid* setupGeneralGrid(const std::string&, const bool usederiv=false);
   //
+  void setupGridCache(const Grid*);
+  void getGridPointIndices(size_t, std::vector<unsigned>&) const;
+  void calculateBiasAndForcesOnGrid(const Grid*, std::vector<double>&);
   void calculateTargetDistAveragesFromGrid(const Grid*);
   //
   bool isStaticTargetDistFileOutputActive() const;
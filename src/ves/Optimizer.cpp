@@ -48,6 +48,7 @@ Optimizer::Optimizer(const ActionOptions&ao):
   iter_counter(0),
   use_hessian_(false),
   diagonal_hessian_(true),
+  hessian_band_(0),
   monitor_instantaneous_gradient_(false),
   use_mwalkers_mpi_(false),
   mwalkers_mpi_single_files_(true),
@@ -199,6 +200,12 @@ Optimizer::Optimizer(const ActionOptions&ao):
     parseFlag("FULL_HESSIAN",full_hessian);
     diagonal_hessian_ = !full_hessian;
   }
+  if(keywords.exists("HESSIAN_BAND")) {
+    parse("HESSIAN_BAND",hessian_band_);
+    if(hessian_band_>0 && diagonal_hessian_) {
+      plumed_merror("HESSIAN_BAND can only be used together with FULL_HESSIAN");
+    }
+  }
   //
   bool mw_single_files = false;
   if(keywords.exists("MULTIPLE_WALKERS")) {
@@ -835,6 +842,7 @@ void Optimizer::registerKeywords( Keywords& keys ) {
   keys.reserve("compulsory","INITIAL_STEPSIZE","the initial step size used for the optimization");
   // Keywords related to the Hessian, actived with the useHessianKeywords function
   keys.reserveFlag("FULL_HESSIAN",false,"if the full Hessian matrix should be used for the optimization, otherwise only the diagonal part of the Hessian is used");
+  keys.reserve("optional","HESSIAN_BAND","only calculate the elements of the full Hessian matrix that are at most this number of positions away from the diagonal, the other elements are set to zero. This reduces the cost of sampling and communicating the Hessian for large basis sets.");
   keys.reserve("hidden","HESSIAN_FILE","the name of output file for the Hessian");
   keys.reserve("hidden","HESSIAN_OUTPUT","how often the Hessian should be written to file. This parameter is given as the number of bias iterations. It is by default 100 if HESSIAN_FILE is specficed");
   keys.reserve("hidden","HESSIAN_FMT","specify format for hessian file(s) (useful for decrease the number of digits in regtests)");
@@ -879,7 +887,8 @@ void Optimizer::registerKeywords( Keywords& keys ) {
 
 
 void Optimizer::useHessianKeywords(Keywords& keys) {
-  // keys.use("FULL_HESSIAN");
+  keys.use("FULL_HESSIAN");
+  keys.use("HESSIAN_BAND");
   keys.use("HESSIAN_FILE");
   keys.use("HESSIAN_OUTPUT");
   keys.use("HESSIAN_FMT");
@@ -938,7 +947,7 @@ void Optimizer::turnOnHessian() {
   use_hessian_=true;
   hessian_pntrs_.clear();
   for(unsigned int i=0; i<nbiases_; i++) {
-    std::vector<CoeffsMatrix*> pntrs_hessian = enableHessian(bias_pntrs_[i],diagonal_hessian_);
+    std::vector<CoeffsMatrix*> pntrs_hessian = enableHessian(bias_pntrs_[i],diagonal_hessian_,hessian_band_);
     for(unsigned int k=0; k<pntrs_hessian.size(); k++) {
       pntrs_hessian[k]->turnOnIterationCounter();
       pntrs_hessian[k]->setIterationCounterAndTime(getIterationCounter(),getTime());
@@ -951,6 +960,9 @@ void Optimizer::turnOnHessian() {
   }
   else {
     log.printf("  Optimization performed using full Hessian matrix\n");
+    if(hessian_band_>0) {
+      log.printf("   only the elements up to %u positions away from the diagonal are calculated\n",hessian_band_);
+    }
   }
   //
   if(hessian_output_fmt_.size()>0) {
@@ -976,9 +988,9 @@ void Optimizer::turnOffHessian() {
 }
 
 
-std::vector<CoeffsMatrix*> Optimizer::enableHessian(VesBias* bias_pntr_in, const bool diagonal_hessian) {
+std::vector<CoeffsMatrix*> Optimizer::enableHessian(VesBias* bias_pntr_in, const bool diagonal_hessian, const unsigned int hessian_band) {
   plumed_massert(use_hessian_,"the Hessian should not be used");
-  bias_pntr_in->enableHessian(diagonal_hessian);
+  bias_pntr_in->enableHessian(diagonal_hessian,hessian_band);
   std::vector<CoeffsMatrix*> hessian_pntrs_out = bias_pntr_in->getHessianPntrs();
   for(unsigned int k=0; k<hessian_pntrs_out.size(); k++) {
     plumed_massert(hessian_pntrs_out[k] != NULL,"Hessian is needed but not linked correctly");
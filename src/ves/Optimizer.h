@@ -65,6 +65,7 @@ private:
   //
   bool use_hessian_;
   bool diagonal_hessian_;
+  unsigned int hessian_band_;
   bool hessian_covariance_from_averages_;
   //
   bool monitor_instantaneous_gradient_;
@@ -130,7 +131,7 @@ private:
 protected:
   void turnOnHessian();
   void turnOffHessian();
-  std::vector<CoeffsMatrix*> enableHessian(VesBias*, const bool diagonal_hessian=false);
+  std::vector<CoeffsMatrix*> enableHessian(VesBias*, const bool diagonal_hessian=false, const unsigned int hessian_band=0);
   // CoeffsMatrix* switchToDiagonalHessian(VesBias*);
   // CoeffsMatrix* switchToFullHessian(VesBias*);
   //
@@ -56,7 +56,11 @@ VesBias::VesBias(const ActionOptions&ao):
   optimize_coeffs_(false),
   compute_hessian_(false),
   diagonal_hessian_(true),
+  hessian_band_(0),
   aver_counters(0),
+  cross_averages_rows(0),
+  cross_averages_block(0),
+  cross_averages_nblock(0),
   kbt_(0.0),
   targetdist_pntrs_(0),
   dynamic_targetdist_(false),
@@ -377,6 +381,9 @@ void VesBias::initializeCoeffs(CoeffsVector* coeffs_pntr_in) {
   std::vector<double> cross_aver_sampled_tmp;
   cross_aver_sampled_tmp.assign(hessian_tmp->getSize(),0.0);
   sampled_cross_averages.push_back(cross_aver_sampled_tmp);
+  cross_averages_rows.push_back(std::vector<size_t>(0));
+  cross_averages_block.push_back(std::vector<double>(0));
+  cross_averages_nblock.push_back(0);
   //
   aver_counters.push_back(0);
   //
@@ -423,6 +430,16 @@ bool VesBias::readCoeffsFromFiles() {
 void VesBias::updateGradientAndHessian(const bool use_mwalkers_mpi) {
   for(unsigned int k=0; k<ncoeffssets_; k++) {
     //
+    if(!diagonal_hessian_) {
+      // the full Hessian is accumulated as a sum of products, turn it into an average
+      flushCrossAverages(k);
+      if(aver_counters[k]>0) {
+        double norm = 1.0/static_cast<double>(aver_counters[k]);
+        for(size_t i=0; i<sampled_cross_averages[k].size(); i++) {
+          sampled_cross_averages[k][i] *= norm;
+        }
+      }
+    }
     comm.Sum(sampled_averages[k]);
     comm.Sum(sampled_cross_averages[k]);
     if(use_mwalkers_mpi) {
@@ -496,31 +513,84 @@ void VesBias::addToSampledAverages(const std::vector<double>& values, const unsi
   */
   double counter_dbl = static_cast<double>(aver_counters[c_id]);
   size_t ncoeffs = numberOfCoeffs(c_id);
-  std::vector<double> deltas(ncoeffs,0.0);
   size_t stride = comm.Get_size();
   size_t rank = comm.Get_rank();
-  // update average and diagonal part of Hessian
+  // update average
   for(size_t i=rank; i<ncoeffs; i+=stride) {
-    size_t midx = getHessianIndex(i,i,c_id);
-    deltas[i] = (values[i]-sampled_averages[c_id][i])/(counter_dbl+1); // (x[n+1]-xm[n])/(n+1)
-    sampled_averages[c_id][i] += deltas[i];
-    sampled_cross_averages[c_id][midx] += (values[i]*values[i]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
+    sampled_averages[c_id][i] += (values[i]-sampled_averages[c_id][i])/(counter_dbl+1); // (x[n+1]-xm[n])/(n+1)
   }
-  comm.Sum(deltas);
-  // update off-diagonal part of the Hessian
-  if(!diagonal_hessian_) {
+  // update diagonal part of the Hessian
+  if(diagonal_hessian_) {
     for(size_t i=rank; i<ncoeffs; i+=stride) {
-      for(size_t j=(i+1); j<ncoeffs; j++) {
-        size_t midx = getHessianIndex(i,j,c_id);
-        sampled_cross_averages[c_id][midx] += (values[i]*values[j]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
-      }
+      size_t midx = getHessianIndex(i,i,c_id);
+      sampled_cross_averages[c_id][midx] += (values[i]*values[i]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
+    }
+  }
+  else {
+    // the products are added to the full Hessian a block of samples at a time, see flushCrossAverages()
+    std::vector<double>& block = cross_averages_block[c_id];
+    unsigned int b = cross_averages_nblock[c_id];
+    for(size_t i=0; i<ncoeffs; i++) {
+      block[i*cross_averages_block_size+b] = values[i];
     }
+    cross_averages_nblock[c_id] += 1;
+    if(cross_averages_nblock[c_id]==cross_averages_block_size) {flushCrossAverages(c_id);}
   }
   // NOTE: the MPI sum for sampled_averages and sampled_cross_averages is done later
   aver_counters[c_id] += 1;
 }
 
 
+void VesBias::setupCrossAverages(const unsigned int c_id) {
+  size_t ncoeffs = numberOfCoeffs(c_id);
+  std::vector<size_t>& rows = cross_averages_rows[c_id];
+  rows.assign(ncoeffs+1,0);
+  if(!diagonal_hessian_) {
+    for(size_t i=0; i<ncoeffs; i++) {
+      size_t nrow = ncoeffs-i;
+      if(hessian_band_>0 && nrow>hessian_band_+1) {nrow=hessian_band_+1;}
+      rows[i+1] = rows[i]+nrow;
+    }
+    cross_averages_block[c_id].assign(ncoeffs*cross_averages_block_size,0.0);
+    sampled_cross_averages[c_id].assign(rows[ncoeffs],0.0);
+  }
+  else {
+    cross_averages_block[c_id].clear();
+    sampled_cross_averages[c_id].assign(Hessian(c_id).getSize(),0.0);
+  }
+  cross_averages_nblock[c_id] = 0;
+}
+
+
+void VesBias::flushCrossAverages(const unsigned int c_id) {
+  /*
+  rank-k update of the upper triangle (or of its band) with the samples stored in the block,
+  each process takes care of every stride-th row as for the averages
+  */
+  unsigned int nblock = cross_averages_nblock[c_id];
+  if(nblock==0) {return;}
+  size_t ncoeffs = numberOfCoeffs(c_id);
+  size_t stride = comm.Get_size();
+  size_t rank = comm.Get_rank();
+  // each process only has the values of its own basis functions, while the
+  // off-diagonal elements also need the values of the other processes
+  if(stride>1) {comm.Sum(cross_averages_block[c_id]);}
+  const std::vector<size_t>& rows = cross_averages_rows[c_id];
+  const double* block = cross_averages_block[c_id].data();
+  double* cross = sampled_cross_averages[c_id].data();
+  for(size_t i=rank; i<ncoeffs; i+=stride) {
+    const double* xi = block+i*cross_averages_block_size;
+    for(size_t k=rows[i]; k<rows[i+1]; k++) {
+      const double* xj = block+(i+k-rows[i])*cross_averages_block_size;
+      double sum = 0.0;
+      for(unsigned int b=0; b<nblock; b++) {sum += xi[b]*xj[b];}
+      cross[k] += sum;
+    }
+  }
+  cross_averages_nblock[c_id] = 0;
+}
+
+
 void VesBias::setTargetDistAverages(const std::vector<double>& coeffderivs_aver_ps, const unsigned int coeffs_id) {
   TargetDistAverages(coeffs_id) = coeffderivs_aver_ps;
   TargetDistAverages(coeffs_id).setIterationCounterAndTime(this->getIterationCounter(),this->getTime());
@@ -574,18 +644,15 @@ void VesBias::linkOptimizer(Optimizer* optimizer_pntr_in) {
 }
 
 
-void VesBias::enableHessian(const bool diagonal_hessian) {
+void VesBias::enableHessian(const bool diagonal_hessian, const unsigned int hessian_band) {
   compute_hessian_=true;
   diagonal_hessian_=diagonal_hessian;
-  sampled_cross_averages.clear();
+  hessian_band_=hessian_band;
   for (unsigned int i=0; i<ncoeffssets_; i++) {
     delete hessian_pntrs_[i];
     std::string label = getCoeffsSetLabelString("hessian",i);
     hessian_pntrs_[i] = new CoeffsMatrix(label,coeffs_pntrs_[i],comm,diagonal_hessian_);
-    //
-    std::vector<double> cross_aver_sampled_tmp;
-    cross_aver_sampled_tmp.assign(hessian_pntrs_[i]->getSize(),0.0);
-    sampled_cross_averages.push_back(cross_aver_sampled_tmp);
+    setupCrossAverages(i);
   }
 }
 
@@ -593,15 +660,12 @@ void VesBias::enableHessian(const bool diagonal_hessian) {
 void VesBias::disableHessian() {
   compute_hessian_=false;
   diagonal_hessian_=true;
-  sampled_cross_averages.clear();
+  hessian_band_=0;
   for (unsigned int i=0; i<ncoeffssets_; i++) {
     delete hessian_pntrs_[i];
     std::string label = getCoeffsSetLabelString("hessian",i);
     hessian_pntrs_[i] = new CoeffsMatrix(label,coeffs_pntrs_[i],comm,diagonal_hessian_);
-    //
-    std::vector<double> cross_aver_sampled_tmp;
-    cross_aver_sampled_tmp.assign(hessian_pntrs_[i]->getSize(),0.0);
-    sampled_cross_averages.push_back(cross_aver_sampled_tmp);
+    setupCrossAverages(i);
   }
 }
 
@@ -78,8 +78,15 @@ private:
   //
   bool compute_hessian_;
   bool diagonal_hessian_;
+  unsigned int hessian_band_;
   //
   std::vector<unsigned int> aver_counters;
+  // for the full Hessian: offset of each row of the upper triangle (or of its band)
+  // within sampled_cross_averages, and the block of samples that still need to be added
+  std::vector<std::vector<size_t> > cross_averages_rows;
+  std::vector<std::vector<double> > cross_averages_block;
+  std::vector<unsigned int> cross_averages_nblock;
+  static const unsigned int cross_averages_block_size=32;
   //
   double kbt_;
   //
@@ -120,6 +127,8 @@ private:
   bool calc_reweightfactor_;
 private:
   void initializeCoeffs(CoeffsVector*);
+  void setupCrossAverages(const unsigned int);
+  void flushCrossAverages(const unsigned int);
   std::vector<double> computeCovarianceFromAverages(const unsigned int) const;
   void multiSimSumAverages(const unsigned int, const double walker_weight=1.0);
 protected:
@@ -190,6 +199,7 @@ public:
   //
   bool computeHessian() const {return compute_hessian_;}
   bool diagonalHessian() const {return diagonal_hessian_;}
+  unsigned int getHessianBand() const {return hessian_band_;}
   //
   bool optimizeCoeffs() const {return optimize_coeffs_;}
   Optimizer* getOptimizerPntr() const {return optimizer_pntr_;}
@@ -204,7 +214,7 @@ public:
   virtual void restartTargetDistributions() {};
   //
   void linkOptimizer(Optimizer*);
-  void enableHessian(const bool diagonal_hessian=true);
+  void enableHessian(const bool diagonal_hessian=true, const unsigned int hessian_band=0);
   void disableHessian();
   //
   void enableMultipleCoeffsSets() {use_multiple_coeffssets_=true;}
@@ -361,17 +371,21 @@ void VesBias::applyBiasCutoff(double& bias, std::vector<double>& forces, std::ve
 inline
 std::vector<double> VesBias::computeCovarianceFromAverages(const unsigned int c_id) const {
   size_t ncoeffs = numberOfCoeffs(c_id);
-  std::vector<double> covariance(sampled_cross_averages[c_id].size(),0.0);
-  // diagonal part
-  for(size_t i=0; i<ncoeffs; i++) {
-    size_t midx = getHessianIndex(i,i,c_id);
-    covariance[midx] = sampled_cross_averages[c_id][midx] - sampled_averages[c_id][i]*sampled_averages[c_id][i];
+  std::vector<double> covariance(Hessian(c_id).getSize(),0.0);
+  if(diagonal_hessian_) {
+    for(size_t i=0; i<ncoeffs; i++) {
+      size_t midx = getHessianIndex(i,i,c_id);
+      covariance[midx] = sampled_cross_averages[c_id][midx] - sampled_averages[c_id][i]*sampled_averages[c_id][i];
+    }
   }
-  if(!diagonal_hessian_) {
+  else {
+    // the elements outside of the band are not sampled and are left to zero
+    const std::vector<size_t>& rows = cross_averages_rows[c_id];
     for(size_t i=0; i<ncoeffs; i++) {
-      for(size_t j=(i+1); j<ncoeffs; j++) {
-        size_t midx = getHessianIndex(i,j,c_id);
-        covariance[midx] = sampled_cross_averages[c_id][midx] - sampled_averages[c_id][i]*sampled_averages[c_id][j];
+      size_t midx = getHessianIndex(i,i,c_id);
+      for(size_t k=rows[i]; k<rows[i+1]; k++) {
+        size_t j = i+k-rows[i];
+        covariance[midx+j-i] = sampled_cross_averages[c_id][k] - sampled_averages[c_id][i]*sampled_averages[c_id][j];
       }
     }
   }
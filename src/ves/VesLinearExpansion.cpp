@@ -33,6 +33,7 @@
 #include "core/ActionRegister.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "tools/Communicator.h"
 
 
 namespace PLMD {
@@ -420,7 +421,8 @@ void VesLinearExpansion::calculate() {
   double bias = bias_expansion_pntr_->getBiasAndForces(cv_values,all_inside,forces,coeffsderivs_values);
   if(biasCutoffActive()) {
     applyBiasCutoff(bias,forces,coeffsderivs_values);
-    coeffsderivs_values[0]=1.0;
+    // each process only holds the values of its own coefficients, the constant one is on the first
+    if(comm.Get_rank()==0) {coeffsderivs_values[0]=1.0;}
   }
   double totalForce2 = 0.0;
   for(unsigned int k=0; k<nargs_; k++) {
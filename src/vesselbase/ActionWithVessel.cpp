@@ -60,6 +60,7 @@ ActionWithVessel::ActionWithVessel(const ActionOptions&ao):
   dertime(true),
   contributorsAreUnlocked(false),
   weightHasDerivatives(false),
+  minTasksPerThread(10),
   mydata(NULL)
 {
   maxderivatives=309; parse("MAXDERIVATIVES",maxderivatives);
@@ -263,7 +264,7 @@ void ActionWithVessel::runAllTasks() {
 
   // Get number of threads for OpenMP
   unsigned nt=OpenMP::getNumThreads();
-  if( nt*stride*10>nactive_tasks ) nt=nactive_tasks/stride/10;
+  if( nt*stride*minTasksPerThread>nactive_tasks ) nt=nactive_tasks/stride/minTasksPerThread;
   if( nt==0 || !threadSafe() ) nt=1;
 
   // Get size for buffer
@@ -101,6 +101,9 @@ protected:
   bool weightHasDerivatives;
 /// This is used for numerical derivatives of bridge variables
   unsigned bridgeVariable;
+/// The minimum number of tasks that are assigned to each OpenMP thread.
+/// Actions whose tasks are expensive can decrease it
+  unsigned minTasksPerThread;
 /// A pointer to the object that stores data
   StoreDataVessel* mydata;
 /// This list is used to update the neighbor list